@@ -0,0 +1,132 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <Executor.h>
+
+#include "utils.h"
+
+#define CONNECTIONS 100000
+#define ACCEPTOR_CAPACITY 64
+
+char *address = "127.0.0.1";
+int port = 40100;
+long connections = CONNECTIONS;
+int multishot = 0;
+
+struct Storm {
+    int server_fd;
+    long accepted;
+    struct Acceptor acceptor;
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void *connect_storm(void *data)
+{
+    (void)data;
+    for (long i = 0; i < connections; ++i) {
+        int fd = connect_to_server(address, port);
+        if (fd < 0) {
+            fprintf(stderr, "Connection %ld failed\n", i);
+            exit(EXIT_FAILURE);
+        }
+        close(fd);
+    }
+
+    return NULL;
+}
+
+void accept_task(struct Executor *executor, void *data)
+{
+    struct Storm *storm = (struct Storm *)data;
+    while (storm->accepted < connections) {
+        int fd = async_accept(executor, storm->server_fd);
+        if (fd < 0) {
+            fprintf(stderr, "Error in accepting connection %d\n", fd);
+            continue;
+        }
+        close(fd);
+        ++storm->accepted;
+    }
+}
+
+void accept_next_task(struct Executor *executor, void *data)
+{
+    struct Storm *storm = (struct Storm *)data;
+    while (storm->accepted < connections) {
+        int fd = async_accept_next(executor, &storm->acceptor);
+        if (fd < 0) {
+            fprintf(stderr, "Error in accepting connection %d\n", fd);
+            continue;
+        }
+        close(fd);
+        ++storm->accepted;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "a:p:n:m")) != -1) {
+        switch (opt) {
+        case 'a':
+            address = optarg;
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'n':
+            connections = atol(optarg);
+            break;
+        case 'm':
+            multishot = 1;
+            break;
+        default:
+            fprintf(stderr,
+                    "Usage: %s [-a address] [-p port] [-n connections] "
+                    "[-m multishot accept]\n",
+                    argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    struct Storm storm = { .server_fd = setup_listen(address, port) };
+    struct Executor executor;
+    if (init_executor(&executor, 4, 256) < 0 ||
+        init_acceptor(&storm.acceptor, &executor.ioc, storm.server_fd,
+                      ACCEPTOR_CAPACITY) < 0) {
+        fprintf(stderr, "Error in init_executor\n");
+        exit(EXIT_FAILURE);
+    }
+
+    async_exec(&executor, multishot ? &accept_next_task : &accept_task,
+               &storm);
+
+    pthread_t client;
+    double start = now_sec();
+    pthread_create(&client, NULL, &connect_storm, NULL);
+    run(&executor);
+    double elapsed = now_sec() - start;
+    pthread_join(client, NULL);
+
+    printf("%s: %.0f connections/s, %.3f kernel enters per connection, "
+           "%lu accept submissions\n",
+           multishot ? "multishot accept" : "accept",
+           (double)storm.accepted / elapsed,
+           (double)executor.ioc.stats.enters / (double)storm.accepted,
+           multishot ? (unsigned long)storm.acceptor.arms
+                     : (unsigned long)storm.accepted);
+
+    free_executor(&executor);
+    free_acceptor(&storm.acceptor);
+    close(storm.server_fd);
+    return 0;
+}
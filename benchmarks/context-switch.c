@@ -0,0 +1,106 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <Context.h>
+
+#define STACK_SIZE 16384
+#define SWITCHES_COUNT 10000000
+
+long switches = SWITCHES_COUNT;
+
+ucontext_t uc_main;
+ucontext_t uc_task;
+
+struct Context ctx_main;
+struct Context ctx_task;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void ucontext_task(void)
+{
+    while (1)
+        swapcontext(&uc_task, &uc_main);
+}
+
+void context_task(void *data)
+{
+    (void)data;
+    while (1)
+        switch_context(&ctx_task, &ctx_main);
+}
+
+double bench_ucontext(void *stack)
+{
+    getcontext(&uc_task);
+    uc_task.uc_stack.ss_sp = stack;
+    uc_task.uc_stack.ss_size = STACK_SIZE;
+    uc_task.uc_link = NULL;
+    makecontext(&uc_task, ucontext_task, 0);
+
+    double start = now_sec();
+    for (long i = 0; i < switches; ++i)
+        swapcontext(&uc_main, &uc_task);
+
+    return now_sec() - start;
+}
+
+double bench_context(void *stack)
+{
+    if (make_context(&ctx_task, stack, STACK_SIZE, &context_task, NULL) < 0) {
+        fprintf(stderr, "make_context failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    double start = now_sec();
+    for (long i = 0; i < switches; ++i)
+        switch_context(&ctx_main, &ctx_task);
+
+    return now_sec() - start;
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n':
+            switches = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n round trips]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    void *uc_stack = malloc(STACK_SIZE);
+    void *ctx_stack = malloc(STACK_SIZE);
+    if (!uc_stack || !ctx_stack)
+        exit(EXIT_FAILURE);
+
+    double uc_elapsed = bench_ucontext(uc_stack);
+    double ctx_elapsed = bench_context(ctx_stack);
+
+#ifdef CRING_USE_UCONTEXT
+    const char *backend = "ucontext";
+#else
+    const char *backend = "assembly";
+#endif
+
+    printf("swapcontext: %.2f ns/switch\n",
+           uc_elapsed * 1e9 / (2.0 * switches));
+    printf("switch_context (%s): %.2f ns/switch\n", backend,
+           ctx_elapsed * 1e9 / (2.0 * switches));
+
+    free(uc_stack);
+    free(ctx_stack);
+    return 0;
+}
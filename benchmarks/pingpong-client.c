@@ -1,3 +1,4 @@
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
@@ -15,47 +16,109 @@ char *address = "127.0.0.1";
 int threads = 1;
 int connections = 1;
 int qps = -1;
+long messages = MESSAGES_COUNT;
+size_t message_size = PACKET_SIZE;
+int fixed = 0;
+struct sockaddr_in server_address;
+struct IOContextOptions options = { 0 };
+struct IOStats stats = { 0 };
+pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Send or receive a whole message, which stream sockets may split in parts.
+ssize_t transfer(struct Executor *executor, int fd, uint8_t *buffer, int send)
+{
+    size_t done = 0;
+    while (done < message_size) {
+        uint8_t *position = buffer + done;
+        size_t left = message_size - done;
+        ssize_t len;
+        if (send)
+            len = fixed ? async_write_fixed(executor, fd, position, left)
+                        : async_write(executor, fd, position, left);
+        else
+            len = fixed ? async_read_fixed(executor, fd, position, left)
+                        : async_read(executor, fd, position, left);
+        if (len <= 0)
+            return len;
+        done += (size_t)len;
+    }
+
+    return (ssize_t)done;
+}
 
 void pingpong_client(struct Executor *executor, void *data)
 {
     (void)data;
-    int fd = connect_to_server(address, port);
-    if (fd < 0) {
+
+    // Connections are set up by the ring, so thousands of them ramp up
+    // without blocking the other clients of the executor.
+    int fd = async_socket(executor, AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || async_connect(executor, fd,
+                                (struct sockaddr *)&server_address,
+                                sizeof(server_address)) < 0) {
         fprintf(stderr, "Connection to server %s:%d intrrupted\n", address,
                 port);
+        if (fd >= 0)
+            async_close(executor, fd);
         return;
     }
 
-    char buffer[PACKET_SIZE] = { 0 };
+    uint8_t *buffer = fixed ? (uint8_t *)acquire_buffer(&executor->ioc)
+                            : (uint8_t *)calloc(1, message_size);
+    if (!buffer) {
+        fprintf(stderr, "Unable to allocate a buffer\n");
+        async_close(executor, fd);
+        return;
+    }
 
-    int counter = 0;
-    while (++counter <= MESSAGES_COUNT) {
-        ssize_t w_len = async_write(executor, fd, (void *)buffer, PACKET_SIZE);
+    long counter = 0;
+    while (++counter <= messages) {
+        ssize_t w_len = transfer(executor, fd, buffer, 1);
         if (w_len <= 0) {
             fprintf(stderr, "Error in sending message %zd\n", w_len);
             break;
         }
 
-        ssize_t r_len = async_read(executor, fd, (void *)buffer, w_len);
+        ssize_t r_len = transfer(executor, fd, buffer, 0);
         if (r_len <= 0) {
             fprintf(stderr, "Error in reading message %zd\n", r_len);
             break;
         }
     }
 
-    close(fd);
+    if (fixed)
+        release_buffer(&executor->ioc, buffer);
+    else
+        free(buffer);
+    async_close(executor, fd);
 }
 
 void *run_thread(void *data)
 {
     (void)data;
     struct Executor executor;
-    init_executor(&executor, 400, 1000);
+    if (init_executor_with_options(&executor, 400, 1000, &options) < 0) {
+        fprintf(stderr, "Error in init_executor\n");
+        exit(EXIT_FAILURE);
+    }
+    if (fixed && register_buffers(&executor.ioc, message_size,
+                                  (uint32_t)connections) < 0) {
+        fprintf(stderr, "Error in register_buffers\n");
+        exit(EXIT_FAILURE);
+    }
     printf("stating ...\n");
     for (int i = 0; i < connections; ++i)
         async_exec(&executor, &pingpong_client, &i);
 
     run(&executor);
+    pthread_mutex_lock(&stats_lock);
+    stats.enters += executor.ioc.stats.enters;
+    stats.spins += executor.ioc.stats.spins;
+    stats.spin_hits += executor.ioc.stats.spin_hits;
+    stats.spin_ns += executor.ioc.stats.spin_ns;
+    stats.sleeps += executor.ioc.stats.sleeps;
+    stats.sleep_ns += executor.ioc.stats.sleep_ns;
+    pthread_mutex_unlock(&stats_lock);
 
     free_executor(&executor);
     pthread_exit(NULL);
@@ -64,7 +127,7 @@ void *run_thread(void *data)
 int main(int argc, char *argv[])
 {
     int opt;
-    while ((opt = getopt(argc, argv, "p:a:t:c:q:")) != -1) {
+    while ((opt = getopt(argc, argv, "p:a:t:c:q:n:s:i:w:b:xl:")) != -1) {
         switch (opt) {
         case 'p':
             port = atoi(optarg);
@@ -82,15 +145,49 @@ int main(int argc, char *argv[])
             printf("QPS not supported");
             // TODO: qps = atoi(optarg);
             break;
+        case 'n':
+            messages = atol(optarg);
+            break;
+        case 's':
+            set_sqpoll(&options, atoi(optarg));
+            break;
+        case 'i':
+            options.sq_thread_idle = (uint32_t)atoi(optarg);
+            break;
+        case 'w':
+            if (parse_wait_policy(optarg, &options) < 0) {
+                fprintf(stderr, "Invalid wait policy %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'b':
+            options.spin_ns = (uint32_t)atoi(optarg) * 1000;
+            break;
+        case 'x':
+            fixed = 1;
+            break;
+        case 'l':
+            message_size = strtoul(optarg, NULL, 10);
+            break;
         default:
             fprintf(
                 stderr,
-                "Usage: %s [-p port] [-a address] [-t threads] [-c connections per thread] [-q query per second limit]\n",
+                "Usage: %s [-p port] [-a address] [-t threads] [-c connections per thread] [-q query per second limit] [-n messages per connection] [-s sqpoll cpu, -1 for any] [-i sqpoll idle ms] [-w wait completions[,timeout us]] [-b busy poll us] [-x fixed buffers] [-l message length]\n",
                 argv[0]);
             exit(EXIT_FAILURE);
         }
     }
 
+    if (!message_size) {
+        fprintf(stderr, "Invalid message length\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (parse_address(address, port, &server_address) < 0) {
+        fprintf(stderr, "Invalid address %s\n", address);
+        exit(EXIT_FAILURE);
+    }
+
     pthread_t *thread_holder = malloc(threads * sizeof(pthread_t));
     if (thread_holder == NULL)
         exit(EXIT_FAILURE);
@@ -111,11 +208,23 @@ int main(int argc, char *argv[])
     free(thread_holder);
 
     printf("Real QPS: %.4f\n",
-           ((double)threads * (double)connections * MESSAGES_COUNT) /
+           ((double)threads * (double)connections * messages) /
                elapsed_time);
     printf("AVG RTT: %.4f us\n",
            elapsed_time * 1e6 /
-               ((double)threads * (double)connections * MESSAGES_COUNT));
+               ((double)threads * (double)connections * messages));
+    printf("Throughput: %.2f MiB/s\n",
+           ((double)threads * (double)connections * messages *
+            (double)message_size) /
+               (elapsed_time * 1024 * 1024));
+    printf("Kernel enters per message: %.4f\n",
+           (double)stats.enters /
+               ((double)threads * (double)connections * messages));
+    printf("Spin: %" PRIu64 " hits out of %" PRIu64 ", spinning %.3f s, "
+           "sleeping %.3f s\n",
+           stats.spin_hits, stats.spins, (double)stats.spin_ns / 1e9,
+           (double)stats.sleep_ns / 1e9);
+    print_cpu_usage(elapsed_time);
 
     return 0;
 }
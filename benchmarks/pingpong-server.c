@@ -1,9 +1,11 @@
 #define _GNU_SOURCE
 #include <pthread.h>
 #include <sched.h>
+#include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <Executor.h>
 
@@ -12,8 +14,16 @@
 #define PACKET_SIZE 1024
 #define FRAME_COUNT 400
 #define RING_SIZE 1000
+#define FILE_SLOTS 4096
 
 int server_fd = -1;
+struct IOContextOptions options = { 0 };
+int direct = 0;
+int fixed = 0;
+uint32_t ring_buffers = 0;
+int multishot = 0;
+int streams = 0;
+size_t message_size = PACKET_SIZE;
 
 struct ThreadInfo {
     int core;
@@ -27,33 +37,190 @@ int bind_cpu(int core)
     return sched_setaffinity(0, sizeof(mask), &mask);
 }
 
+ssize_t echo_read(struct Executor *executor, int fd, uint8_t *buffer)
+{
+    if (direct)
+        return async_read_direct(executor, (uint32_t)fd, buffer, message_size);
+    if (fixed)
+        return async_read_fixed(executor, fd, buffer, message_size);
+    return async_read(executor, fd, buffer, message_size);
+}
+
+ssize_t echo_write(struct Executor *executor, int fd, uint8_t *buffer,
+                   size_t size)
+{
+    // Large messages may be sent in several parts by stream sockets.
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t len;
+        if (direct)
+            len = async_write_direct(executor, (uint32_t)fd, buffer + sent,
+                                     size - sent);
+        else if (fixed)
+            len = async_write_fixed(executor, fd, buffer + sent, size - sent);
+        else
+            len = async_write(executor, fd, buffer + sent, size - sent);
+        if (len <= 0)
+            return len;
+        sent += (size_t)len;
+    }
+
+    return (ssize_t)sent;
+}
+
 void client_handler(struct Executor *executor, void *data)
 {
-    int fd = *(int *)data;
-    uint8_t buffer[PACKET_SIZE];
+    int fd = (int)(intptr_t)data;
+    uint8_t *buffer = fixed ? (uint8_t *)acquire_buffer(&executor->ioc)
+                            : (uint8_t *)malloc(message_size);
+
+    while (buffer) {
+        ssize_t r_len = echo_read(executor, fd, buffer);
+        if (r_len <= 0) {
+            fprintf(stderr, "Error in reading message %zd\n", r_len);
+            break;
+        }
+
+        ssize_t w_len = echo_write(executor, fd, buffer, (size_t)r_len);
+        if (w_len != r_len) {
+            fprintf(stderr, "Error in sending message %zd\n", w_len);
+            break;
+        }
+    }
+
+    if (!buffer)
+        fprintf(stderr, "Unable to allocate a buffer\n");
+    else if (fixed)
+        release_buffer(&executor->ioc, buffer);
+    else
+        free(buffer);
+
+    if (direct)
+        unregister_file(&executor->ioc, (uint32_t)fd);
+    else
+        async_close(executor, fd);
+}
+
+void ring_client_handler(struct Executor *executor, void *data)
+{
+    int fd = (int)(intptr_t)data;
+
+    // No buffer is held while the connection is idle.
+    while (true) {
+        uint16_t id;
+        ssize_t r_len = async_recv_select(executor, fd, &id);
+        if (r_len <= 0) {
+            fprintf(stderr, "Error in reading message %zd\n", r_len);
+            break;
+        }
+
+        uint8_t *buffer = (uint8_t *)provided_buffer(&executor->ioc, id);
+        ssize_t w_len = echo_write(executor, fd, buffer, (size_t)r_len);
+        recycle_buffer(&executor->ioc, id);
+        if (w_len != r_len) {
+            fprintf(stderr, "Error in sending message %zd\n", w_len);
+            break;
+        }
+    }
+
+    async_close(executor, fd);
+}
+
+void stream_client_handler(struct Executor *executor, void *data)
+{
+    int fd = (int)(intptr_t)data;
+    struct RecvStream stream;
+    if (init_recv_stream(&stream, &executor->ioc, fd) < 0) {
+        fprintf(stderr, "Unable to create a receive stream\n");
+        async_close(executor, fd);
+        return;
+    }
 
+    uint16_t id;
     while (true) {
-        ssize_t r_len = async_read(executor, fd, (void *)buffer, PACKET_SIZE);
+        ssize_t r_len = async_recv_next(executor, &stream, &id);
         if (r_len <= 0) {
             fprintf(stderr, "Error in reading message %zd\n", r_len);
             break;
         }
 
-        ssize_t w_len = async_write(executor, fd, (void *)buffer, r_len);
+        uint8_t *buffer = (uint8_t *)provided_buffer(&executor->ioc, id);
+        ssize_t w_len = echo_write(executor, fd, buffer, (size_t)r_len);
+        recycle_buffer(&executor->ioc, id);
         if (w_len != r_len) {
             fprintf(stderr, "Error in sending message %zd\n", w_len);
             break;
         }
     }
 
-    close(fd);
+    // The armed request references the stream until the kernel ends it.
+    async_shutdown(executor, fd, SHUT_RD);
+    while (stream.armed)
+        if (async_recv_next(executor, &stream, &id) > 0)
+            recycle_buffer(&executor->ioc, id);
+
+    free_recv_stream(&stream);
+    async_close(executor, fd);
+}
+
+Func connection_handler(void)
+{
+    if (streams)
+        return &stream_client_handler;
+    return ring_buffers ? &ring_client_handler : &client_handler;
+}
+
+void direct_pingpong_server(struct Executor *executor, void *data)
+{
+    while (true) {
+        int slot = async_accept_direct(executor, *(int *)data);
+        if (slot < 0) {
+            fprintf(stderr, "Error in accepting connection %d\n", slot);
+            continue;
+        }
+
+        if (async_exec(executor, &client_handler, (void *)(intptr_t)slot) < 0) {
+            fprintf(stderr, "Unable to start handler, dropping connection\n");
+            unregister_file(&executor->ioc, (uint32_t)slot);
+        }
+    }
 }
 
 void pingpong_server(struct Executor *executor, void *data)
 {
     while (true) {
         int fd = async_accept(executor, *(int *)data);
-        async_exec(executor, &client_handler, &fd);
+        if (fd < 0) {
+            fprintf(stderr, "Error in accepting connection %d\n", fd);
+            continue;
+        }
+
+        Func handler = connection_handler();
+        if (async_exec(executor, handler, (void *)(intptr_t)fd) < 0) {
+            fprintf(stderr, "Unable to start handler, dropping connection\n");
+            close(fd);
+        }
+    }
+}
+
+void multishot_pingpong_server(struct Executor *executor, void *data)
+{
+    struct Acceptor *acceptor = (struct Acceptor *)data;
+    Func handler = connection_handler();
+
+    // Connections accepted in a burst are taken without suspending, so the
+    // handlers get their descriptor by value before any of them runs.
+    while (true) {
+        int fd = async_accept_next(executor, acceptor);
+        if (fd < 0) {
+            fprintf(stderr, "Error in accepting connection %d\n", fd);
+            continue;
+        }
+
+        if (async_exec(executor, handler, (void *)(intptr_t)fd) < 0) {
+            fprintf(stderr, "Unable to start handler, dropping connection\n");
+            close(fd);
+        }
     }
 }
 
@@ -63,10 +230,48 @@ void *init_server(void *data)
     bind_cpu(info->core);
 
     struct Executor executor;
-    init_executor(&executor, FRAME_COUNT, RING_SIZE);
-    async_exec(&executor, &pingpong_server, &server_fd);
+    if (init_executor_with_options(&executor, FRAME_COUNT, RING_SIZE,
+                                   &options) < 0) {
+        fprintf(stderr, "Error in init_executor\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (direct && register_files(&executor.ioc, FILE_SLOTS, 0) < 0) {
+        fprintf(stderr, "Error in register_files\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (fixed &&
+        register_buffers(&executor.ioc, message_size, FRAME_COUNT) < 0) {
+        fprintf(stderr, "Error in register_buffers\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (ring_buffers &&
+        register_buffer_ring(&executor.ioc, message_size, ring_buffers) < 0) {
+        fprintf(stderr, "Error in register_buffer_ring\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct Acceptor acceptor;
+    if (multishot &&
+        init_acceptor(&acceptor, &executor.ioc, server_fd, FRAME_COUNT) < 0) {
+        fprintf(stderr, "Error in init_acceptor\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("ring setup flags: 0x%x\n", executor.ioc.setup_flags);
+    fflush(stdout);
+    if (multishot)
+        async_exec(&executor, &multishot_pingpong_server, &acceptor);
+    else
+        async_exec(&executor,
+                   direct ? &direct_pingpong_server : &pingpong_server,
+                   &server_fd);
     run(&executor);
     free_executor(&executor);
+    if (multishot)
+        free_acceptor(&acceptor);
     pthread_exit(NULL);
 }
 
@@ -78,7 +283,7 @@ int main(int argc, char *argv[])
     int threads_no = 1;
 
     int opt;
-    while ((opt = getopt(argc, argv, "p:a:c:t:")) != -1) {
+    while ((opt = getopt(argc, argv, "p:a:c:t:f:q:s:i:w:b:dxl:r:mu")) != -1) {
         switch (opt) {
         case 'p':
             port = atoi(optarg);
@@ -92,16 +297,81 @@ int main(int argc, char *argv[])
         case 't':
             threads_no = atoi(optarg);
             break;
+        case 'f':
+            if (parse_setup_flags(optarg, &options.flags) < 0) {
+                fprintf(stderr, "Unknown setup flags %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'q':
+            options.cq_entries = (uint32_t)atoi(optarg);
+            break;
+        case 's':
+            set_sqpoll(&options, atoi(optarg));
+            break;
+        case 'i':
+            options.sq_thread_idle = (uint32_t)atoi(optarg);
+            break;
+        case 'w':
+            if (parse_wait_policy(optarg, &options) < 0) {
+                fprintf(stderr, "Invalid wait policy %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'b':
+            options.spin_ns = (uint32_t)atoi(optarg) * 1000;
+            break;
+        case 'd':
+            direct = 1;
+            break;
+        case 'x':
+            fixed = 1;
+            break;
+        case 'l':
+            message_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            ring_buffers = (uint32_t)atoi(optarg);
+            break;
+        case 'm':
+            multishot = 1;
+            break;
+        case 'u':
+            streams = 1;
+            break;
         default:
             fprintf(stderr,
-                    "Usage: %s [-p port] [-a address] [-c core] [-t threads]\n",
+                    "Usage: %s [-p port] [-a address] [-c core] [-t threads] "
+                    "[-f single,defer,coop,taskrun,clamp] [-q cq entries] "
+                    "[-s sqpoll cpu, -1 for any] [-i sqpoll idle ms] "
+                    "[-w wait completions[,timeout us]] [-b busy poll us] "
+                    "[-d direct descriptors] [-x fixed buffers] "
+                    "[-l message length] [-r provided buffers] "
+                    "[-m multishot accept] [-u multishot receive, with -r]\n",
                     argv[0]);
             exit(EXIT_FAILURE);
         }
     }
 
+    if (!message_size || direct + fixed + (ring_buffers > 0) > 1 ||
+        (direct && multishot) || (streams && !ring_buffers)) {
+        fprintf(stderr, "Invalid message length, or -d, -x and -r combined, "
+                        "or -d combined with -m, or -u without -r\n");
+        exit(EXIT_FAILURE);
+    }
+
     server_fd = setup_listen(address, port);
 
+    // The server runs until it is interrupted, then reports its CPU usage.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
     pthread_t *threads = malloc(threads_no * sizeof(pthread_t));
     struct ThreadInfo *thread_info =
         malloc(threads_no * sizeof(struct ThreadInfo));
@@ -113,11 +383,16 @@ int main(int argc, char *argv[])
         pthread_create(&threads[t], NULL, &init_server, &thread_info[t]);
     }
 
-    for (int t = 0; t < threads_no; ++t)
-        pthread_join(threads[t], NULL);
+    int received;
+    sigwait(&signals, &received);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    print_cpu_usage((end.tv_sec - start.tv_sec) +
+                    (end.tv_nsec - start.tv_nsec) / 1e9);
+    fflush(stdout);
 
+    // The server threads never return: exit without joining them.
     free(threads);
     free(thread_info);
-
-    return 0;
+    _exit(EXIT_SUCCESS);
 }
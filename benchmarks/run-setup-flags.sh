@@ -0,0 +1,51 @@
+#!/bin/bash
+# Run the ping-pong benchmark once per io_uring setup flag set, then with
+# the submission queues of both sides polled by kernel threads.
+#
+# Usage: benchmarks/run-setup-flags.sh [build directory] [client options]
+# e.g.   benchmarks/run-setup-flags.sh Release -c 100 -n 100000
+# The server and client cores are set with SERVER_CPU and CLIENT_CPU, the
+# cores of their SQPOLL threads with SERVER_SQ_CPU and CLIENT_SQ_CPU.
+
+BUILD=${1:-Release}
+shift
+CLIENT_OPTIONS=${@:--c 100 -n 100000}
+SERVER_CPU=${SERVER_CPU:-1}
+CLIENT_CPU=${CLIENT_CPU:-2}
+SERVER_SQ_CPU=${SERVER_SQ_CPU:-3}
+CLIENT_SQ_CPU=${CLIENT_SQ_CPU:-4}
+
+SERVER=./$BUILD/benchmarks/pingpong-server
+CLIENT=./$BUILD/benchmarks/pingpong-client
+
+FLAG_SETS=(
+    none
+    coop
+    coop,taskrun
+    single
+    single,defer
+)
+
+# The listening socket of a killed server can outlive it while its ring is
+# torn down, so every run uses its own port.
+port=40000
+
+# run <title> <server options> <client options>
+run() {
+    port=$((port + 1))
+    echo "== $1"
+    taskset -c $SERVER_CPU $SERVER -p $port -c $SERVER_CPU $2 &
+    server=$!
+    sleep 1
+
+    taskset -c $CLIENT_CPU $CLIENT -p $port $3 $CLIENT_OPTIONS
+
+    kill $server
+    wait $server 2>/dev/null
+}
+
+for flags in "${FLAG_SETS[@]}"; do
+    run "setup flags: $flags" "-f $flags" ""
+done
+
+run "sqpoll" "-s $SERVER_SQ_CPU" "-s $CLIENT_SQ_CPU"
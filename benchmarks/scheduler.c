@@ -0,0 +1,135 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <Executor.h>
+
+#define ROUND_TRIPS 20000
+#define WARMUP_ROUND_TRIPS 100
+#define MAX_IDLE_FRAMES 100000
+
+long round_trips = ROUND_TRIPS;
+size_t max_idle_frames = MAX_IDLE_FRAMES;
+
+struct Bench {
+    int fds[2];
+    size_t idle_count;
+    size_t parked;
+    struct Frame **idle;
+    double elapsed;
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void idle_task(struct Executor *executor, void *data)
+{
+    struct Bench *bench = (struct Bench *)data;
+    bench->idle[bench->parked++] = get_current_frame(executor);
+    suspend_current_frame(executor);
+}
+
+void echo_task(struct Executor *executor, void *data)
+{
+    struct Bench *bench = (struct Bench *)data;
+    char byte = 0;
+
+    for (long i = 0; i < round_trips + WARMUP_ROUND_TRIPS; ++i) {
+        if (async_read(executor, bench->fds[1], &byte, 1) != 1)
+            break;
+        if (async_write(executor, bench->fds[1], &byte, 1) != 1)
+            break;
+    }
+}
+
+void ping_task(struct Executor *executor, void *data)
+{
+    struct Bench *bench = (struct Bench *)data;
+    char byte = 0;
+
+    double start = 0;
+    for (long i = 0; i < round_trips + WARMUP_ROUND_TRIPS; ++i) {
+        if (i == WARMUP_ROUND_TRIPS)
+            start = now_sec();
+        if (async_write(executor, bench->fds[0], &byte, 1) != 1)
+            break;
+        if (async_read(executor, bench->fds[0], &byte, 1) != 1)
+            break;
+    }
+    bench->elapsed = now_sec() - start;
+
+    for (size_t i = 0; i < bench->parked; ++i)
+        push_ready_frame(executor, bench->idle[i]);
+}
+
+int run_bench(size_t idle_count)
+{
+    struct Bench bench = { .idle_count = 0 };
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, bench.fds) < 0)
+        return -1;
+
+    bench.idle = malloc(idle_count * sizeof(struct Frame *));
+    if (!bench.idle)
+        return -1;
+
+    struct Executor executor;
+    if (init_executor(&executor, idle_count + 2, 64) < 0)
+        return -1;
+
+    if (async_exec(&executor, &echo_task, &bench) < 0 ||
+        async_exec(&executor, &ping_task, &bench) < 0)
+        return -1;
+
+    while (bench.idle_count < idle_count &&
+           async_exec(&executor, &idle_task, &bench) == 0)
+        ++bench.idle_count;
+
+    run(&executor);
+    struct StackPoolStats stats = executor.stacks.stats;
+    free_executor(&executor);
+
+    printf("idle frames: %8zu  round trip: %10.2f ns  stack pool hits: %" PRIu64
+           " misses: %" PRIu64 " resident: %zu KiB\n",
+           bench.idle_count, bench.elapsed * 1e9 / (double)round_trips,
+           stats.hits, stats.misses, stats.resident_bytes / 1024);
+
+    free(bench.idle);
+    close(bench.fds[0]);
+    close(bench.fds[1]);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:m:")) != -1) {
+        switch (opt) {
+        case 'n':
+            round_trips = atol(optarg);
+            break;
+        case 'm':
+            max_idle_frames = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n round trips] [-m max idle frames]\n",
+                    argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (size_t idle = 10; idle <= max_idle_frames; idle *= 10) {
+        if (run_bench(idle) < 0) {
+            fprintf(stderr, "Benchmark with %zu idle frames failed\n", idle);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <Executor.h>
+
+#include "utils.h"
+
+#define TOTAL_MIB 1024
+// TCP notifies a zero-copy send once the data is acknowledged, so enough
+// buffers have to be in flight to cover the delayed acknowledgements.
+#define BUFFERS 16
+#define MIN_SIZE (16 * 1024)
+#define MAX_SIZE (1024 * 1024)
+
+char *address = "127.0.0.1";
+int port = 40200;
+long total_mib = TOTAL_MIB;
+
+struct Bench;
+
+struct Slot {
+    struct Bench *bench;
+    char *buffer;
+    int busy;
+};
+
+struct Bench {
+    int fd;
+    int zero_copy;
+    size_t size;
+    size_t sent;
+    int error;
+    struct Executor *executor;
+    struct Frame *sender;
+    struct Slot slots[BUFFERS];
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void *receive_all(void *data)
+{
+    (void)data;
+    static char sink[MAX_SIZE];
+
+    int fd = connect_to_server(address, port);
+    if (fd < 0) {
+        fprintf(stderr, "Connection failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    while (recv(fd, sink, sizeof(sink), 0) > 0)
+        ;
+
+    close(fd);
+    return NULL;
+}
+
+void release_slot(void *data)
+{
+    struct Slot *slot = (struct Slot *)data;
+    struct Bench *bench = slot->bench;
+    slot->busy = 0;
+
+    // Wake the sender if it parked on this buffer.
+    if (bench->sender) {
+        struct Frame *sender = bench->sender;
+        bench->sender = NULL;
+        push_ready_frame(bench->executor, sender);
+    }
+}
+
+static void wait_for_slot(struct Executor *executor, struct Bench *bench,
+                          struct Slot *slot)
+{
+    while (slot->busy) {
+        bench->sender = get_current_frame(executor);
+        suspend_current_frame(executor);
+    }
+}
+
+static ssize_t send_copy(struct Executor *executor, int fd, char *buffer,
+                         size_t size)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = async_write(executor, fd, buffer + done, size - done);
+        if (ret <= 0)
+            return ret;
+        done += (size_t)ret;
+    }
+
+    return (ssize_t)done;
+}
+
+void send_task(struct Executor *executor, void *data)
+{
+    struct Bench *bench = (struct Bench *)data;
+    size_t total = (size_t)total_mib * 1024 * 1024;
+
+    for (size_t i = 0; bench->sent < total; ++i) {
+        struct Slot *slot = &bench->slots[i % BUFFERS];
+        ssize_t ret;
+        if (bench->zero_copy) {
+            wait_for_slot(executor, bench, slot);
+            slot->busy = 1;
+            ret = async_send_zc(executor, bench->fd, slot->buffer, bench->size,
+                                &release_slot, slot);
+            // A request that failed at submission is never released.
+            if (ret < 0)
+                slot->busy = 0;
+        } else {
+            ret = send_copy(executor, bench->fd, slot->buffer, bench->size);
+        }
+
+        if (ret != (ssize_t)bench->size) {
+            bench->error = ret < 0 ? (int)ret : -1;
+            break;
+        }
+        bench->sent += (size_t)ret;
+    }
+
+    // The buffers stay in use until the kernel released all of them.
+    for (int i = 0; i < BUFFERS; ++i)
+        wait_for_slot(executor, bench, &bench->slots[i]);
+}
+
+double run_bench(int listen_fd, size_t size, int zero_copy,
+                 struct IOStats *stats)
+{
+    struct Bench bench = { .zero_copy = zero_copy, .size = size };
+    struct Executor executor;
+    if (init_executor(&executor, 4, 256) < 0) {
+        fprintf(stderr, "Error in init_executor\n");
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_t receiver;
+    pthread_create(&receiver, NULL, &receive_all, NULL);
+    bench.fd = accept(listen_fd, NULL, NULL);
+    if (bench.fd < 0) {
+        fprintf(stderr, "Error in accepting the receiver\n");
+        exit(EXIT_FAILURE);
+    }
+
+    bench.executor = &executor;
+    for (int i = 0; i < BUFFERS; ++i) {
+        bench.slots[i].bench = &bench;
+        bench.slots[i].buffer = malloc(size);
+        if (!bench.slots[i].buffer) {
+            fprintf(stderr, "Error in allocating buffers\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(bench.slots[i].buffer, 'a' + i, size);
+    }
+
+    double start = now_sec();
+    async_exec(&executor, &send_task, &bench);
+    run(&executor);
+    shutdown(bench.fd, SHUT_WR);
+    pthread_join(receiver, NULL);
+    double elapsed = now_sec() - start;
+
+    if (bench.error < 0) {
+        fprintf(stderr, "Error in sending %zu byte buffers: %d\n", size,
+                bench.error);
+        exit(EXIT_FAILURE);
+    }
+
+    *stats = executor.ioc.stats;
+    free_executor(&executor);
+    for (int i = 0; i < BUFFERS; ++i)
+        free(bench.slots[i].buffer);
+    close(bench.fd);
+    return (double)bench.sent / (1024.0 * 1024.0) / elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "a:p:n:")) != -1) {
+        switch (opt) {
+        case 'a':
+            address = optarg;
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'n':
+            total_mib = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-a address] [-p port] [-n MiB]\n",
+                    argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    int listen_fd = setup_listen(address, port);
+    for (size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 4) {
+        struct IOStats stats;
+        double copy = run_bench(listen_fd, size, 0, &stats);
+        double zero_copy = run_bench(listen_fd, size, 1, &stats);
+        printf("size: %7zu  write: %8.0f MiB/s  send_zc: %8.0f MiB/s  "
+               "copied by the kernel: %lu of %lu\n",
+               size, copy, zero_copy, (unsigned long)stats.zc_copied,
+               (unsigned long)stats.zc_sends);
+    }
+
+    close(listen_fd);
+    return 0;
+}
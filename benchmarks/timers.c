@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <Executor.h>
+
+#define TIMERS 1000000
+#define MAX_DELAY_MS 60000
+#define FIRE_SPAN_MS 10000
+#define SLEEPERS 1000
+#define SLEEPS 100
+
+long timers_no = TIMERS;
+long sleepers = SLEEPERS;
+
+struct Sleeps {
+    int kernel;
+    long done;
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void count_fire(void *data)
+{
+    ++*(long *)data;
+}
+
+void bench_arm_cancel(struct Timer *timers, double *arm, double *cancel)
+{
+    struct TimerWheel wheel;
+    uint64_t state = 88172645463325252ULL;
+    uint64_t start = 1000 * TIMER_TICK_NS;
+    long fired = 0;
+
+    init_timer_wheel(&wheel, start);
+    for (long i = 0; i < timers_no; ++i)
+        init_timer(&timers[i], &count_fire, &fired);
+
+    double begin = now_sec();
+    for (long i = 0; i < timers_no; ++i) {
+        uint64_t delay = next_random(&state) % (MAX_DELAY_MS * TIMER_TICK_NS);
+        arm_timer(&wheel, &timers[i], start + TIMER_TICK_NS + delay);
+    }
+    double middle = now_sec();
+    for (long i = 0; i < timers_no; ++i)
+        cancel_timer(&wheel, &timers[i]);
+    double end = now_sec();
+
+    *arm = (middle - begin) * 1e9 / (double)timers_no;
+    *cancel = (end - middle) * 1e9 / (double)timers_no;
+}
+
+double bench_fire(struct Timer *timers)
+{
+    struct TimerWheel wheel;
+    uint64_t state = 88172645463325252ULL;
+    uint64_t start = 1000 * TIMER_TICK_NS;
+    long fired = 0;
+
+    init_timer_wheel(&wheel, start);
+    for (long i = 0; i < timers_no; ++i) {
+        init_timer(&timers[i], &count_fire, &fired);
+        uint64_t delay = next_random(&state) % (FIRE_SPAN_MS * TIMER_TICK_NS);
+        arm_timer(&wheel, &timers[i], start + TIMER_TICK_NS + delay);
+    }
+
+    // Advance a tick at a time, as a busy event loop would.
+    double begin = now_sec();
+    for (uint64_t ms = 1; ms <= FIRE_SPAN_MS + 1; ++ms)
+        advance_timer_wheel(&wheel, start + ms * TIMER_TICK_NS);
+    double end = now_sec();
+
+    if (fired != timers_no) {
+        fprintf(stderr, "Fired %ld timers of %ld\n", fired, timers_no);
+        exit(EXIT_FAILURE);
+    }
+    return (end - begin) * 1e9 / (double)timers_no;
+}
+
+// A sleep with one kernel timeout per call, as async_wait used to be.
+static int kernel_sleep(struct Executor *executor,
+                        struct __kernel_timespec *ts)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_wait(&executor->ioc, ts, NULL, &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0))
+        return ret;
+
+    suspend_current_frame(executor);
+    return 0;
+}
+
+void sleeping_task(struct Executor *executor, void *data)
+{
+    struct Sleeps *sleeps = (struct Sleeps *)data;
+    struct __kernel_timespec ts = { .tv_sec = 0, .tv_nsec = 1000000 };
+
+    for (int i = 0; i < SLEEPS; ++i) {
+        int ret = sleeps->kernel ? kernel_sleep(executor, &ts)
+                                 : async_wait(executor, &ts);
+        if (ret < 0)
+            return;
+    }
+    ++sleeps->done;
+}
+
+double bench_sleep(int kernel, uint64_t *enters)
+{
+    struct Executor executor;
+    struct Sleeps sleeps = { .kernel = kernel };
+    if (init_executor(&executor, (size_t)sleepers + 1, 1024) < 0) {
+        fprintf(stderr, "Error in init_executor\n");
+        exit(EXIT_FAILURE);
+    }
+
+    double start = now_sec();
+    for (long i = 0; i < sleepers; ++i)
+        async_exec(&executor, &sleeping_task, &sleeps);
+    run(&executor);
+    double elapsed = now_sec() - start;
+
+    if (sleeps.done != sleepers) {
+        fprintf(stderr, "Error in sleeping tasks\n");
+        exit(EXIT_FAILURE);
+    }
+
+    *enters = executor.ioc.stats.enters;
+    free_executor(&executor);
+    return elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:")) != -1) {
+        switch (opt) {
+        case 'n':
+            timers_no = atol(optarg);
+            break;
+        case 't':
+            sleepers = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n timers] [-t sleeping tasks]\n",
+                    argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    struct Timer *timers = malloc((size_t)timers_no * sizeof(struct Timer));
+    if (!timers) {
+        fprintf(stderr, "Error in allocating timers\n");
+        exit(EXIT_FAILURE);
+    }
+
+    double arm, cancel;
+    bench_arm_cancel(timers, &arm, &cancel);
+    printf("%ld timers over %d s: arm %.2f ns, cancel %.2f ns\n", timers_no,
+           MAX_DELAY_MS / 1000, arm, cancel);
+    printf("%ld timers over %d s: fire %.2f ns\n", timers_no,
+           FIRE_SPAN_MS / 1000, bench_fire(timers));
+    free(timers);
+
+    uint64_t wheel_enters, kernel_enters;
+    double wheel = bench_sleep(0, &wheel_enters);
+    double kernel = bench_sleep(1, &kernel_enters);
+    printf("%ld tasks sleeping %d x 1 ms: timer wheel %.3f s, %lu enters, "
+           "kernel timeouts %.3f s, %lu enters\n",
+           sleepers, SLEEPS, wheel, (unsigned long)wheel_enters, kernel,
+           (unsigned long)kernel_enters);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <IOContext.h>
+
+#define OPERATIONS 10000000
+#define BATCH 64
+#define CAPACITY 4096
+
+long operations = OPERATIONS;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+double bench_single(struct IOContext *ioc)
+{
+    double start = now_sec();
+    for (long i = 0; i < operations; ++i) {
+        struct Token *token = get_token(ioc);
+        token->data = (void *)i;
+        __asm__ volatile("" : : "r"(token_user_data(ioc, token)) : "memory");
+        release_token(ioc, token);
+    }
+
+    return now_sec() - start;
+}
+
+double bench_batch(struct IOContext *ioc, int bulk)
+{
+    uint32_t indices[BATCH];
+    struct Token *tokens[BATCH];
+
+    double start = now_sec();
+    for (long i = 0; i < operations; i += BATCH) {
+        for (int j = 0; j < BATCH; ++j) {
+            tokens[j] = get_token(ioc);
+            tokens[j]->data = (void *)i;
+            __asm__ volatile("" : : "r"(token_user_data(ioc, tokens[j]))
+                             : "memory");
+        }
+
+        if (bulk) {
+            for (int j = 0; j < BATCH; ++j)
+                indices[j] = (uint32_t)(tokens[j] - ioc->tokens);
+            release_tokens(ioc, indices, BATCH);
+        } else {
+            for (int j = 0; j < BATCH; ++j)
+                release_token(ioc, tokens[j]);
+        }
+    }
+
+    return now_sec() - start;
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n':
+            operations = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n operations]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    struct IOContext ioc;
+    if (init_io_context(&ioc, CAPACITY) < 0) {
+        fprintf(stderr, "init_io_context failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    double single = bench_single(&ioc);
+    double batch = bench_batch(&ioc, 0);
+    double bulk = bench_batch(&ioc, 1);
+
+    printf("get + release_token: %.2f ns/token\n",
+           single * 1e9 / (double)operations);
+    printf("batch of %d, release_token: %.2f ns/token\n", BATCH,
+           batch * 1e9 / (double)operations);
+    printf("batch of %d, release_tokens: %.2f ns/token\n", BATCH,
+           bulk * 1e9 / (double)operations);
+
+    free_io_context(&ioc);
+    return 0;
+}
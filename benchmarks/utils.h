@@ -7,17 +7,27 @@ extern "C" {
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+
+#include <IOContext.h>
+
+int parse_address(const char *addr, int port, struct sockaddr_in *address)
+{
+    memset(address, 0, sizeof(*address));
+    address->sin_family = AF_INET;
+    address->sin_port = htons(port);
+
+    return inet_pton(AF_INET, addr, &address->sin_addr) <= 0 ? -1 : 0;
+}
 
 int connect_to_server(const char *addr, int port)
 {
     struct sockaddr_in server_address;
-    memset(&server_address, 0, sizeof(server_address));
-    server_address.sin_family = AF_INET;
-    server_address.sin_port = htons(port);
-
-    if (inet_pton(AF_INET, addr, &server_address.sin_addr) <= 0)
+    if (parse_address(addr, port, &server_address) < 0)
         return -1;
 
     int client_fd = socket(PF_INET, SOCK_STREAM, 0);
@@ -43,10 +53,96 @@ int setup_listen(const char *addr, int port)
     srv_addr.sin_addr.s_addr = inet_addr(addr);
 
     bind(sock, (const struct sockaddr *)(&srv_addr), sizeof(srv_addr));
-    listen(sock, 10);
+    listen(sock, SOMAXCONN);
     return sock;
 }
 
+/*
+ * Parse a comma separated list of ring setup flags, e.g. "single,defer".
+ * Known names: none, single, defer, coop, taskrun, clamp.
+ */
+int parse_setup_flags(const char *list, uint32_t *flags)
+{
+    static const struct {
+        const char *name;
+        uint32_t flag;
+    } names[] = {
+        { "none", 0 },
+        { "single", IORING_SETUP_SINGLE_ISSUER },
+        { "defer", IORING_SETUP_DEFER_TASKRUN },
+        { "coop", IORING_SETUP_COOP_TASKRUN },
+        { "taskrun", IORING_SETUP_TASKRUN_FLAG },
+        { "clamp", IORING_SETUP_CLAMP },
+    };
+
+    *flags = 0;
+    while (*list) {
+        size_t length = strcspn(list, ",");
+        size_t i = 0;
+        for (; i < sizeof(names) / sizeof(names[0]); ++i) {
+            if (strlen(names[i].name) == length &&
+                strncmp(names[i].name, list, length) == 0)
+                break;
+        }
+
+        if (i == sizeof(names) / sizeof(names[0]))
+            return -1;
+
+        *flags |= names[i].flag;
+        list += length;
+        if (*list == ',')
+            ++list;
+    }
+
+    return 0;
+}
+
+/*
+ * Parse a wait policy "completions[,timeout_us]", e.g. "32,50".
+ */
+int parse_wait_policy(const char *policy, struct IOContextOptions *options)
+{
+    char *end = NULL;
+    options->wait_completions = (uint32_t)strtoul(policy, &end, 10);
+    options->wait_timeout_us = 0;
+    if (*end == ',')
+        options->wait_timeout_us = (uint32_t)strtoul(end + 1, &end, 10);
+
+    return *end || options->wait_completions == 0 ? -1 : 0;
+}
+
+/*
+ * Poll the submission queue of the ring from a kernel thread, bound to the
+ * given CPU unless it is negative.
+ */
+void set_sqpoll(struct IOContextOptions *options, int cpu)
+{
+    options->flags |= IORING_SETUP_SQPOLL;
+    if (cpu >= 0) {
+        options->flags |= IORING_SETUP_SQ_AFF;
+        options->sq_thread_cpu = (uint32_t)cpu;
+    }
+}
+
+/*
+ * Print the CPU time used by the process over the elapsed wall clock time,
+ * and its peak resident memory. The SQPOLL threads of its rings are
+ * accounted to the process.
+ */
+void print_cpu_usage(double elapsed)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) < 0)
+        return;
+
+    double user = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    double system = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    printf("CPU: user %.2f s, system %.2f s, %.1f%% of %.2f s, "
+           "max RSS %ld KiB\n",
+           user, system, (user + system) * 100 / elapsed, elapsed,
+           usage.ru_maxrss);
+}
+
 #ifdef __cplusplus
 }
 #endif
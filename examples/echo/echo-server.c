@@ -36,7 +36,15 @@ void echo_server(struct Executor *executor, void *data)
     printf("Started ...\n");
     while (true) {
         int fd = async_accept(executor, *(int *)data);
-        async_exec(executor, &client_handler, &fd);
+        if (fd < 0) {
+            fprintf(stderr, "Error in accepting connection\n");
+            continue;
+        }
+
+        if (async_exec(executor, &client_handler, &fd) < 0) {
+            fprintf(stderr, "Error in starting client handler\n");
+            close(fd);
+        }
     }
 }
 
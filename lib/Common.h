@@ -7,6 +7,7 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdio.h>
+#include <time.h>
 
 #ifdef NDEBUG
 #define LOG_DEBUG(format, ...)
@@ -25,6 +26,32 @@ extern "C" {
 #define unlikely(x) __builtin_expect(!!(x), 0)
 #define likely(x) __builtin_expect(!!(x), 1)
 
+#define CACHE_LINE_SIZE 64
+
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+
+/*
+ * Hint the CPU that the caller is busy waiting, which saves power and frees
+ * resources for the sibling hyper-thread.
+ */
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield" ::: "memory");
+#else
+    __asm__ volatile("" ::: "memory");
+#endif
+}
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 static inline uint64_t align64pow2(uint64_t v)
 {
     --v;
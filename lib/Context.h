@@ -0,0 +1,105 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#if !defined(__x86_64__) && !defined(__aarch64__) && \
+    !defined(CRING_USE_UCONTEXT)
+#define CRING_USE_UCONTEXT
+#endif
+
+#ifdef CRING_USE_UCONTEXT
+#include <ucontext.h>
+#endif
+
+typedef void (*ContextEntry)(void * /*data*/);
+
+/**
+ * @struct Context
+ * @brief Represents the saved machine state of a suspended coroutine.
+ *
+ * With the default assembly backend only the stack pointer is stored here;
+ * the callee-saved registers live on the coroutine stack itself, pushed by
+ * `cring_switch_context` right before the switch. When the library is built
+ * with `CRING_UCONTEXT` (or on an unsupported architecture) the context falls
+ * back to glibc's `ucontext_t`.
+ *
+ * - `void *sp`: Stack pointer of the suspended coroutine (assembly backend).
+ * - `ucontext_t uc`: Full user context of the suspended coroutine (ucontext backend).
+ */
+struct Context {
+#ifdef CRING_USE_UCONTEXT
+    ucontext_t uc;
+#else
+    void *sp;
+#endif
+};
+
+/**
+ * Prepare a context to start executing a function on the given stack.
+ *
+ * The first switch to the context calls `entry(data)` on top of the provided
+ * stack. The entry function must never return; it has to switch to another
+ * context once it is done.
+ *
+ * @param ctx
+ *   A pointer to the Context structure to be initialized.
+ * @param stack
+ *   A pointer to the lowest address of the stack memory.
+ * @param size
+ *   The size of the stack memory in bytes.
+ * @param entry
+ *   The function to execute when the context is switched to for the first time.
+ * @param data
+ *   The argument passed to the entry function.
+ * @return
+ *   0 on success, -1 on failure.
+ */
+int make_context(struct Context *ctx, void *stack, size_t size,
+                 ContextEntry entry, void *data);
+
+#ifndef CRING_USE_UCONTEXT
+/**
+ * Save the callee-saved registers of the caller and resume another context.
+ *
+ * Implemented in assembly for each supported architecture. The current stack
+ * pointer is stored to `from_sp` and execution continues on `to_sp`.
+ *
+ * @param from_sp
+ *   Location where the stack pointer of the current context is stored.
+ * @param to_sp
+ *   The stack pointer of the context to resume.
+ */
+void cring_switch_context(void **from_sp, void *to_sp);
+#endif
+
+/**
+ * Switch from the current context to another context.
+ *
+ * This static inline function saves the state of the running code in `from`
+ * and resumes the execution of `to`. It returns once another context switches
+ * back to `from`.
+ *
+ * @param from
+ *   A pointer to the Context structure in which the current state is saved.
+ * @param to
+ *   A pointer to the Context structure to resume.
+ */
+static inline void switch_context(struct Context *from, struct Context *to)
+{
+#ifdef CRING_USE_UCONTEXT
+    swapcontext(&from->uc, &to->uc);
+#else
+    cring_switch_context(&from->sp, to->sp);
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
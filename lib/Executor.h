@@ -5,12 +5,22 @@
 extern "C" {
 #endif
 
-#include <ucontext.h>
+#include <errno.h>
 
+#include "Context.h"
 #include "IOContext.h"
+#include "Stack.h"
+#include "TimerWheel.h"
 
-#define STACK_SIZE 8192
+/*
+ * glibc formats output to unbuffered streams such as stderr through an 8 KiB
+ * buffer on the stack, so a smaller default would overflow into the guard
+ * page on the first error message. Pages are committed lazily, so the unused
+ * part of the stack costs no memory.
+ */
+#define STACK_SIZE (32 * 1024)
 #define BATCH_SIZE 1024
+#define FRAME_LIMIT (1UL << 20)
 
 /**
  * @struct Frame
@@ -19,18 +29,83 @@ extern "C" {
  * The Frame structure encapsulates the essential components needed for managing
  * the state and execution of an individual asynchronous task or coroutine.
  *
- * - `ucontext_t exe`: Execution context associated with the task, including the program
- *    counter, stack pointer, and register values.
- * - `ssize_t result`: Result or status of the execution of the associated task.
- * - `int is_ready`: Flag indicating whether the task is ready for execution or has completed.
+ * - `struct Waiter waiter`: Result of the last I/O operation of the task, ready flag
+ *    and link in the ready queue. Completions resume the frame directly through it.
+ *    It must stay the first member, so that a Waiter can be converted back to its Frame.
+ * - `struct Context exe`: Execution context associated with the task, holding the
+ *    saved stack pointer and callee-saved registers of a suspended task.
+ * - `size_t index`: Position of the frame in the executor's frames array.
+ * - `struct Executor *executor`: The executor owning the frame.
+ * - `Func fn`: The task function started on the frame by `async_exec`.
+ * - `void *data`: Additional data passed to the task function.
+ * - `struct Stack stack`: Guarded stack of the running task, taken from the executor's
+ *    stack pool by `async_exec` and returned to it when the task finishes.
+ * - `uint32_t generation`: Incremented each time a task finishes on the frame, so
+ *    that a TaskHandle outliving its task can be told apart from the next task.
+ * - `struct Frame *joiners`: Frames suspended in `async_join` on this task.
+ * - `struct Frame *next_joiner`: Link to the next frame joining the same task,
+ *    while this frame is suspended in `async_join`.
+ * - `struct TaskGroup *group`: The group the task was spawned in, or NULL.
  *
  * This structure is integral to the asynchronous programming model in Cring, providing
  * a container for the context and result of individual tasks within the event loop.
  */
+struct Executor;
+struct TaskGroup;
+
+typedef void (*Func)(struct Executor *, void *);
+
 struct Frame {
-    ucontext_t exe;
-    ssize_t result;
-    int is_ready;
+    struct Waiter waiter;
+    struct Context exe;
+    size_t index;
+    struct Executor *executor;
+    Func fn;
+    void *data;
+    struct Stack stack;
+    uint32_t generation;
+    struct Frame *joiners;
+    struct Frame *next_joiner;
+    struct TaskGroup *group;
+};
+
+/**
+ * @struct TaskHandle
+ * @brief Identifies a task started with 'async_spawn'.
+ *
+ * Frames are reused once their task finished, so a handle pairs the frame
+ * with its generation at the start of the task. A handle is only valid as
+ * long as the generations match, see 'task_running'.
+ *
+ * - `struct Frame *frame`: The frame the task runs on.
+ * - `uint32_t generation`: The generation of the frame when the task started.
+ */
+struct TaskHandle {
+    struct Frame *frame;
+    uint32_t generation;
+};
+
+/**
+ * @struct TaskGroup
+ * @brief Tracks the tasks spawned by a parent task to wait for them.
+ *
+ * A group lives wherever the parent keeps it, typically on its stack, and
+ * its members point to it from their frames: spawning and waiting allocate
+ * nothing. The parent must wait for all the members with
+ * 'async_group_wait_all' before the group goes away.
+ *
+ * - `size_t running`: Number of members that have not finished yet.
+ * - `size_t finished`: Number of finished members not reported by
+ *    'async_group_wait_any' yet.
+ * - `struct Frame *waiter`: The frame suspended on the group, or NULL.
+ * - `int wait_all`: Whether the waiter waits for all the members, or for the
+ *    next one to finish.
+ */
+struct TaskGroup {
+    size_t running;
+    size_t finished;
+    struct Frame *waiter;
+    int wait_all;
 };
 
 /**
@@ -38,14 +113,22 @@ struct Frame {
  * @brief Represents the executor for managing asynchronous tasks in the Cring library.
  *
  * The Executor structure holds information about the execution context, the current
- * task being processed, the total number of tasks, the maximum capacity of tasks,
+ * task being processed, the total number of tasks, the current capacity of tasks,
  * and an array of Frame pointers representing individual tasks or coroutines.
+ * Frames are allocated in chunks that never move, so the frames array can grow
+ * on demand while suspended tasks keep pointers to their frames.
  *
  * - `struct IOContext ioc`: The IOContext associated with the executor for managing I/O operations.
  * - `size_t current`: Index of the currently active task in the executor.
  * - `size_t size`: Current number of tasks scheduled in the executor.
- * - `size_t capacity`: Maximum number of tasks the executor can handle.
+ * - `size_t capacity`: Number of frames currently allocated, main frame included.
+ * - `size_t frame_limit`: Maximum number of tasks the executor grows to, main frame excluded.
  * - `struct Frame **frames`: Dynamic array of Frame pointers representing individual tasks.
+ * - `struct Frame **chunks`: Blocks of frames allocated by the executor.
+ * - `size_t chunk_count`: Number of blocks in `chunks`.
+ * - `struct StackPool stacks`: Pool of coroutine stacks shared by the frames.
+ * - `struct TimerWheel timers`: Timers of the tasks. The event loop wakes up for
+ *    the nearest of them with a single timeout of the IOContext.
  *
  * This structure plays a crucial role in orchestrating and managing the asynchronous
  * execution of tasks within the Cring event loop.
@@ -55,11 +138,14 @@ struct Executor {
     size_t current;
     size_t size;
     size_t capacity;
+    size_t frame_limit;
     struct Frame **frames;
+    struct Frame **chunks;
+    size_t chunk_count;
+    struct StackPool stacks;
+    struct TimerWheel timers;
 };
 
-typedef void (*Func)(struct Executor *, void *);
-
 /**
  * Retrieve the last frame from the Executor's frame array.
  *
@@ -111,28 +197,57 @@ static inline struct Frame *main_frame(struct Executor *executor)
 }
 
 /**
- * Move to the next ready frame in the Executor's frame stack.
+ * Append a frame to the Executor's ready queue.
+ *
+ * This static inline function marks the frame as ready and links it at the
+ * tail of the intrusive FIFO ready queue of the given Executor's IOContext,
+ * which also receives the frames resumed by I/O completions. A frame that is
+ * already marked as ready is not queued twice.
+ *
+ * @param executor
+ *   A pointer to the Executor structure owning the ready queue.
+ * @param frame
+ *   A pointer to the frame to be scheduled.
+ */
+static inline void push_ready_frame(struct Executor *executor,
+                                    struct Frame *frame)
+{
+    push_ready_waiter(&executor->ioc, &frame->waiter);
+}
+
+/**
+ * Remove the first frame from the Executor's ready queue.
+ *
+ * @param executor
+ *   A pointer to the Executor structure owning the ready queue.
+ * @return
+ *   A pointer to the oldest ready frame, or NULL if the queue is empty.
+ */
+static inline struct Frame *pop_ready_frame(struct Executor *executor)
+{
+    return (struct Frame *)pop_ready_waiter(&executor->ioc);
+}
+
+/**
+ * Move to the next ready frame in the Executor's ready queue.
  *
- * This static inline function advances to the next frame in the frame stack
- * of the given Executor that is marked as ready for execution. It updates the
- * 'current' index of the Executor and retrieves the corresponding frame.
- * The function continues looping until it finds a frame marked as ready.
+ * This static inline function pops the oldest frame from the ready queue of
+ * the given Executor and makes it the current frame. When no frame is ready
+ * the main frame is selected, so that it can wait for I/O completions. The
+ * cost does not depend on the number of suspended frames.
  *
  * @param executor
  *   A pointer to the Executor structure to navigate and find the next ready frame.
  * @return
- *   A pointer to the next ready frame in the frame stack.
+ *   A pointer to the next ready frame, or the main frame if none is ready.
  */
 static inline struct Frame *move_to_next_ready_frame(struct Executor *executor)
 {
-    struct Frame *frame = NULL;
-
-    do {
-        ++executor->current;
-        executor->current = executor->current % executor->size;
-        frame = get_current_frame(executor);
-    } while (!frame->is_ready);
+    struct Frame *frame = pop_ready_frame(executor);
+    if (!frame)
+        frame = main_frame(executor);
 
+    executor->current = frame->index;
     return frame;
 }
 
@@ -140,10 +255,12 @@ static inline struct Frame *move_to_next_ready_frame(struct Executor *executor)
  * Suspend the execution of the current frame in the Executor.
  *
  * This static inline function suspends the execution of the current frame in
- * the given Executor. It sets the 'is_ready' flag of the current frame to 0,
+ * the given Executor. It clears the 'is_ready' flag of the current frame,
  * indicating that it is not ready for immediate execution. It then proceeds to
- * find and switch to the next frame in the frame stack that is marked as ready.
- * The function utilizes the swapcontext function for context switching.
+ * switch to the next frame of the ready queue, or to the main frame if the
+ * queue is empty. The frame runs again once a completion pushes it back onto
+ * the ready queue. The function utilizes the switch_context function for
+ * context switching.
  *
  * @param executor
  *   A pointer to the Executor structure containing the current frame.
@@ -151,76 +268,194 @@ static inline struct Frame *move_to_next_ready_frame(struct Executor *executor)
 static inline void suspend_current_frame(struct Executor *executor)
 {
     struct Frame *current = get_current_frame(executor);
-    current->is_ready = 0;
+    current->waiter.is_ready = 0;
     struct Frame *next = move_to_next_ready_frame(executor);
-    swapcontext(&current->exe, &next->exe);
+    switch_context(&current->exe, &next->exe);
 }
 
 /**
- * Callback function for asynchronous wait completion.
+ * Suspend the current frame until the submission queue has room again.
  *
- * This function is a callback invoked upon the completion of an asynchronous
- * wait operation. It sets the 'is_ready' flag of the associated frame to 1,
- * indicating that the frame is ready for execution.
+ * This static inline function parks the current frame in the submission queue
+ * waiters of the Executor's IOContext and suspends it. The frame becomes ready
+ * again once the next 'process' call has flushed the submission queue, so that
+ * a request which failed with -EBUSY can be retried instead of reporting the
+ * ring pressure to the caller.
  *
- * @param data
- *   A pointer to the data associated with the asynchronous wait operation,
- *   typically pointing to a Frame structure.
+ * @param executor
+ *   A pointer to the Executor structure containing the current frame.
  */
-void wait_fn(void *data);
+static inline void wait_for_sqe(struct Executor *executor)
+{
+    struct Frame *frame = get_current_frame(executor);
+    push_sq_waiter(&executor->ioc, &frame->waiter);
+    suspend_current_frame(executor);
+}
 
 /**
- * Asynchronously wait for a specified period in the Executor.
+ * Suspend the current frame until a token is available.
  *
- * This static inline function initiates an asynchronous wait operation in the
- * given Executor, allowing the current frame to be suspended for the specified
- * duration. It utilizes the request_wait function with the provided time
- * specification, wait function, and current frame. Upon a successful request,
- * the function suspends the current frame's execution until the wait completes.
+ * This function parks the current frame in the token waiters of the
+ * Executor's IOContext and suspends it. Waiters are resumed in FIFO order as
+ * tokens are released, each with a token reserved for its retry, so an
+ * overloaded executor degrades into queueing latency instead of failing
+ * requests. The number and the duration of the waits are accounted in the
+ * IOContext's stats.
  *
  * @param executor
- *   A pointer to the Executor structure managing the asynchronous wait.
- * @param ts
- *   A pointer to the timespec structure specifying the wait duration.
+ *   A pointer to the Executor structure containing the current frame.
+ */
+void wait_for_token(struct Executor *executor);
+
+/**
+ * Wait for the resource a request ran out of, if it is worth retrying.
+ *
+ * @param executor
+ *   A pointer to the Executor structure containing the current frame.
+ * @param error
+ *   The negative error code returned by a request function.
  * @return
- *   0 on success, or an error code on failure.
+ *   1 if the current frame waited for a submission queue entry (-EBUSY) or a
+ *   token (-ENOBUFS) and the request should be retried, 0 otherwise.
  */
-static inline int async_wait(struct Executor *executor,
-                             struct __kernel_timespec *ts)
+static inline int retry_request(struct Executor *executor, int error)
 {
-    struct Frame *frame = get_current_frame(executor);
-    int ret = request_wait(&executor->ioc, ts, &wait_fn, frame);
-    if (unlikely(ret < 0)) {
-        LOG_ERROR("wait request failed %d", ret);
-        return ret;
+    if (error == -EBUSY) {
+        wait_for_sqe(executor);
+        return 1;
     }
-    suspend_current_frame(executor);
+
+    if (error == -ENOBUFS) {
+        wait_for_token(executor);
+        return 1;
+    }
+
     return 0;
 }
 
 /**
- * Callback function for asynchronous accept completion.
+ * Retrieve the cached clock of the Executor.
  *
- * This function is a callback invoked upon the completion of an asynchronous
- * accept operation. It sets the 'result' field of the associated frame to the
- * accepted file descriptor and marks the frame as ready for execution.
+ * The event loop reads CLOCK_MONOTONIC once per turn, before it fires the
+ * expired timers, so that tasks computing deadlines do not read the clock
+ * each. The cached value lags behind by the time the ready tasks of the
+ * current turn have been running.
  *
- * @param fd
- *   The accepted file descriptor resulting from the accept operation.
- * @param data
- *   A pointer to the data associated with the asynchronous accept operation,
- *   typically pointing to a Frame structure.
+ * @param executor
+ *   A pointer to the Executor structure.
+ * @return
+ *   The time of the current turn of the event loop, in nanoseconds.
+ */
+static inline uint64_t executor_now(struct Executor *executor)
+{
+    return executor->timers.now_ns;
+}
+
+/**
+ * Arm a timer of the Executor for a deadline.
+ *
+ * The callback of the timer runs on the main frame once the deadline has
+ * passed, e.g. to shut down an idle connection. Arming an armed timer moves
+ * it, in constant time. The timer must be stopped before its memory goes
+ * away.
+ *
+ * @param executor
+ *   A pointer to the Executor structure.
+ * @param timer
+ *   A pointer to a Timer initialized with 'init_timer'.
+ * @param deadline_ns
+ *   The deadline on CLOCK_MONOTONIC, in nanoseconds, see 'executor_now'.
+ */
+static inline void start_timer(struct Executor *executor, struct Timer *timer,
+                               uint64_t deadline_ns)
+{
+    arm_timer(&executor->timers, timer, deadline_ns);
+}
+
+/**
+ * Stop a timer of the Executor, in constant time.
+ *
+ * @param executor
+ *   A pointer to the Executor structure.
+ * @param timer
+ *   A pointer to the Timer structure.
+ * @return
+ *   1 if the timer was armed, 0 if it already fired or was never armed.
+ */
+static inline int stop_timer(struct Executor *executor, struct Timer *timer)
+{
+    return cancel_timer(&executor->timers, timer);
+}
+
+static inline void resume_sleeping_frame(void *data)
+{
+    struct Frame *frame = (struct Frame *)data;
+    push_ready_frame(frame->executor, frame);
+}
+
+/**
+ * Asynchronously sleep until a deadline.
+ *
+ * This static inline function arms a timer of the Executor's timer wheel,
+ * kept on the stack of the current frame, and suspends the frame until it
+ * fires. No request is submitted per sleeping task: the event loop keeps a
+ * single timeout in flight for the nearest timer of the wheel. Deadlines are
+ * rounded up to the next TIMER_TICK_NS.
+ *
+ * @param executor
+ *   A pointer to the Executor structure.
+ * @param deadline_ns
+ *   The deadline on CLOCK_MONOTONIC, in nanoseconds, see 'executor_now'.
+ * @return
+ *   0 once the deadline has passed, or -EINTR if another task resumed the
+ *   frame before.
  */
-void accept_fn(int fd, void *data);
+static inline int async_sleep_until(struct Executor *executor,
+                                    uint64_t deadline_ns)
+{
+    struct Frame *frame = get_current_frame(executor);
+    struct Timer timer;
+    init_timer(&timer, &resume_sleeping_frame, frame);
+    arm_timer(&executor->timers, &timer, deadline_ns);
+    suspend_current_frame(executor);
+
+    // The timer lives on this stack, so it must not outlive an early resume.
+    return cancel_timer(&executor->timers, &timer) ? -EINTR : 0;
+}
+
+/**
+ * Asynchronously wait for a specified period in the Executor.
+ *
+ * This static inline function suspends the current frame for the specified
+ * duration, counted from the cached clock of the Executor, with
+ * 'async_sleep_until'. The duration is rounded up to the next TIMER_TICK_NS.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the asynchronous wait.
+ * @param ts
+ *   A pointer to the timespec structure specifying the wait duration.
+ * @return
+ *   0 on success, or -EINTR if another task resumed the frame before.
+ */
+static inline int async_wait(struct Executor *executor,
+                             struct __kernel_timespec *ts)
+{
+    uint64_t duration =
+        (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+    return async_sleep_until(executor, executor_now(executor) + duration);
+}
 
 /**
  * Asynchronously initiate an accept operation in the Executor.
  *
  * This static inline function initiates an asynchronous accept operation on
  * the given file descriptor within the provided Executor. It utilizes the
- * request_accept function with the specified file descriptor, accept function,
- * and current frame. Upon a successful request, the function suspends the
- * current frame's execution until the accept operation completes.
+ * request_accept function with the specified file descriptor and the current
+ * frame's waiter, which the completion resumes directly. If the submission
+ * queue stays full, the frame waits for room with 'wait_for_sqe' and retries,
+ * and it waits for a token with 'wait_for_token' when the token pool is
+ * exhausted. Upon a successful request, the function suspends the current
+ * frame's execution until the accept operation completes.
  *
  * @param executor
  *   A pointer to the Executor structure managing the asynchronous accept.
@@ -228,42 +463,33 @@ void accept_fn(int fd, void *data);
  *   The file descriptor on which to perform the accept operation.
  * @return
  *   0 on success, or an error code on failure. The result of the operation
- *   can be retrieved from the associated frame's 'result' field.
+ *   can be retrieved from the associated frame's 'waiter.result' field.
  */
 static inline int async_accept(struct Executor *executor, int fd)
 {
     struct Frame *frame = get_current_frame(executor);
-    int ret = request_accept(&executor->ioc, fd, &accept_fn, frame);
+    int ret;
+    do {
+        ret = request_accept(&executor->ioc, fd, NULL, &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
     if (unlikely(ret < 0)) {
         LOG_ERROR("accept request failed %d", ret);
         return ret;
     }
     suspend_current_frame(executor);
-    return frame->result;
+    return frame->waiter.result;
 }
 
-/**
- * Callback function for asynchronous read completion.
- *
- * This function is a callback invoked upon the completion of an asynchronous
- * read operation. It sets the 'result' field of the associated frame to the
- * length of the read data and marks the frame as ready for execution.
- *
- * @param length
- *   The length of the data read during the asynchronous read operation.
- * @param data
- *   A pointer to the data associated with the asynchronous read operation,
- *   typically pointing to a Frame structure.
- */
-void read_fn(ssize_t length, void *data);
-
 /**
  * Asynchronously initiate a read operation in the Executor.
  *
  * This static inline function initiates an asynchronous read operation on
  * the given file descriptor within the provided Executor. It utilizes the
  * request_read function with the specified file descriptor, buffer, size,
- * read function, and current frame. Upon a successful request, the function
+ * and the current frame's waiter, which the completion resumes directly. If
+ * the submission queue stays full, the frame waits for room with
+ * 'wait_for_sqe' and retries, and it waits for a token with 'wait_for_token'
+ * when the token pool is exhausted. Upon a successful request, the function
  * suspends the current frame's execution until the read operation completes.
  *
  * @param executor
@@ -276,43 +502,35 @@ void read_fn(ssize_t length, void *data);
  *   The number of bytes to read.
  * @return
  *   The number of bytes read on success, or an error code on failure.
- *   The result of the operation can be retrieved from the associated frame's 'result' field.
+ *   The result of the operation can be retrieved from the associated frame's 'waiter.result' field.
  */
 static inline ssize_t async_read(struct Executor *executor, int fd,
                                  void *buffer, size_t size)
 {
     struct Frame *frame = get_current_frame(executor);
-    int ret = request_read(&executor->ioc, fd, buffer, size, &read_fn, frame);
+    int ret;
+    do {
+        ret = request_read(&executor->ioc, fd, buffer, size, NULL,
+                           &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
     if (unlikely(ret < 0)) {
         LOG_ERROR("read request failed %d", ret);
         return ret;
     }
     suspend_current_frame(executor);
-    return frame->result;
+    return frame->waiter.result;
 }
 
-/**
- * Callback function for asynchronous write completion.
- *
- * This function is a callback invoked upon the completion of an asynchronous
- * write operation. It sets the 'result' field of the associated frame to the
- * length of the written data and marks the frame as ready for execution.
- *
- * @param length
- *   The length of the data written during the asynchronous write operation.
- * @param data
- *   A pointer to the data associated with the asynchronous write operation,
- *   typically pointing to a Frame structure.
- */
-void write_fn(ssize_t length, void *data);
-
 /**
  * Asynchronously initiate a write operation in the Executor.
  *
  * This static inline function initiates an asynchronous write operation on
  * the given file descriptor within the provided Executor. It utilizes the
  * request_write function with the specified file descriptor, buffer, size,
- * write function, and current frame. Upon a successful request, the function
+ * and the current frame's waiter, which the completion resumes directly. If
+ * the submission queue stays full, the frame waits for room with
+ * 'wait_for_sqe' and retries, and it waits for a token with 'wait_for_token'
+ * when the token pool is exhausted. Upon a successful request, the function
  * suspends the current frame's execution until the write operation completes.
  *
  * @param executor
@@ -325,140 +543,1239 @@ void write_fn(ssize_t length, void *data);
  *   The number of bytes to write.
  * @return
  *   The number of bytes written on success, or an error code on failure.
- *   The result of the operation can be retrieved from the associated frame's 'result' field.
+ *   The result of the operation can be retrieved from the associated frame's 'waiter.result' field.
  */
 static inline ssize_t async_write(struct Executor *executor, int fd,
                                   void *buffer, size_t size)
 {
     struct Frame *frame = get_current_frame(executor);
-    int ret = request_write(&executor->ioc, fd, buffer, size, &write_fn, frame);
+    int ret;
+    do {
+        ret = request_write(&executor->ioc, fd, buffer, size, NULL,
+                            &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
     if (unlikely(ret < 0)) {
         LOG_ERROR("write request failed %d", ret);
         return ret;
     }
 
     suspend_current_frame(executor);
-    return frame->result;
+    return frame->waiter.result;
 }
 
 /**
- * Wrapper function for asynchronous task execution in the Executor.
+ * Convert a deadline on CLOCK_MONOTONIC in nanoseconds to a timespec.
+ *
+ * @param deadline_ns
+ *   The deadline in nanoseconds, see 'executor_now'.
+ * @param ts
+ *   A pointer to the timespec structure to fill.
+ */
+static inline void deadline_to_timespec(uint64_t deadline_ns,
+                                        struct __kernel_timespec *ts)
+{
+    ts->tv_sec = (int64_t)(deadline_ns / 1000000000ULL);
+    ts->tv_nsec = (long long)(deadline_ns % 1000000000ULL);
+}
+
+/**
+ * Asynchronously accept a connection, unless a deadline passes first.
  *
- * This function serves as a higher-level wrapper for executing a function within
- * the context of a cooperative multitasking environment managed by an Executor.
- * It executes the provided function, typically performing an asynchronous task,
- * and then manages the completion of the task by calling the 'manage_async_finish'
- * function.
+ * This static inline function works like 'async_accept', with
+ * request_accept_until: the kernel cancels the accept at the deadline by
+ * itself, so no watchdog task or wake up of the event loop is needed.
  *
- * @param fn
- *   The function to execute asynchronously within the Executor.
  * @param executor
- *   A pointer to the Executor structure managing the cooperative multitasking.
- * @param data
- *   Additional data to be passed to the asynchronous function.
+ *   A pointer to the Executor structure managing the asynchronous accept.
+ * @param fd
+ *   The listening socket.
+ * @param deadline_ns
+ *   The deadline on CLOCK_MONOTONIC, in nanoseconds, see 'executor_now'.
+ * @return
+ *   The accepted file descriptor, -ETIME if the deadline passed first, or
+ *   another error code on failure.
  */
-void execute(Func fn, struct Executor *executor, void *data);
+static inline int async_accept_until(struct Executor *executor, int fd,
+                                     uint64_t deadline_ns)
+{
+    struct Frame *frame = get_current_frame(executor);
+    struct __kernel_timespec deadline;
+    deadline_to_timespec(deadline_ns, &deadline);
+    int ret;
+    do {
+        ret = request_accept_until(&executor->ioc, fd, &deadline, NULL,
+                                   &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("accept request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
 
 /**
- * Swap the current frame with the last frame in the Executor's frame stack.
+ * Asynchronously read, unless a deadline passes first.
  *
- * This static inline function swaps the positions of the current frame and the
- * last frame in the frame stack of the given Executor. If the last frame is not
- * the same as the current frame, no swap occurs. The function returns a pointer
- * to the newly positioned current frame after the swap.
+ * This static inline function works like 'async_read', with
+ * request_read_until: the kernel cancels the read at the deadline by itself.
  *
  * @param executor
- *   A pointer to the Executor structure managing the frame stack.
+ *   A pointer to the Executor structure managing the asynchronous read.
+ * @param fd
+ *   The file descriptor on which to perform the read operation.
+ * @param buffer
+ *   A pointer to the buffer where the read data will be stored.
+ * @param size
+ *   The number of bytes to read.
+ * @param deadline_ns
+ *   The deadline on CLOCK_MONOTONIC, in nanoseconds, see 'executor_now'.
  * @return
- *   A pointer to the current frame after the swap, or NULL if no swap occurred.
+ *   The number of bytes read, -ETIME if the deadline passed first, or another
+ *   error code on failure.
  */
-static inline struct Frame *
-swap_current_frame_with_last_frame(struct Executor *executor)
+static inline ssize_t async_read_until(struct Executor *executor, int fd,
+                                       void *buffer, size_t size,
+                                       uint64_t deadline_ns)
 {
-    struct Frame *current = get_current_frame(executor);
-    struct Frame *last = get_last_frame(executor);
-
-    if (last == current)
-        return NULL;
-
-    struct Frame *tmp = last;
-    executor->frames[executor->size - 1] = current;
-    executor->frames[executor->current] = tmp;
-    return executor->frames[executor->current];
+    struct Frame *frame = get_current_frame(executor);
+    struct __kernel_timespec deadline;
+    deadline_to_timespec(deadline_ns, &deadline);
+    int ret;
+    do {
+        ret = request_read_until(&executor->ioc, fd, buffer, size, &deadline,
+                                 NULL, &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("read request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
 }
 
 /**
- * Manage the completion of an asynchronous task in the Executor.
+ * Asynchronously write, unless a deadline passes first.
  *
- * This static inline function manages the completion of an asynchronous task
- * within the given Executor. It swaps the current frame with the last frame,
- * reduces the frame stack size, and performs context switching based on the
- * readiness of the current frame and the availability of the next ready frame.
+ * This static inline function works like 'async_write', with
+ * request_write_until: the kernel cancels the write at the deadline by
+ * itself, e.g. when a slow peer never drains its socket.
  *
  * @param executor
- *   A pointer to the Executor structure managing the asynchronous task.
+ *   A pointer to the Executor structure managing the asynchronous write.
+ * @param fd
+ *   The file descriptor on which to perform the write operation.
+ * @param buffer
+ *   A pointer to the buffer containing the data to be written.
+ * @param size
+ *   The number of bytes to write.
+ * @param deadline_ns
+ *   The deadline on CLOCK_MONOTONIC, in nanoseconds, see 'executor_now'.
+ * @return
+ *   The number of bytes written, -ETIME if the deadline passed first, or
+ *   another error code on failure.
  */
-static inline void manage_async_finish(struct Executor *executor)
+static inline ssize_t async_write_until(struct Executor *executor, int fd,
+                                        void *buffer, size_t size,
+                                        uint64_t deadline_ns)
 {
-    struct Frame *current = swap_current_frame_with_last_frame(executor);
-    --executor->size;
-
-    if (current) {
-        if (current->is_ready) {
-            swapcontext(&executor->frames[executor->size]->exe, &current->exe);
-        } else {
-            struct Frame *next = move_to_next_ready_frame(executor);
-            if (next != main_frame(executor))
-                swapcontext(&executor->frames[executor->size]->exe, &next->exe);
-        }
+    struct Frame *frame = get_current_frame(executor);
+    struct __kernel_timespec deadline;
+    deadline_to_timespec(deadline_ns, &deadline);
+    int ret;
+    do {
+        ret = request_write_until(&executor->ioc, fd, buffer, size, &deadline,
+                                  NULL, &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("write request failed %d", ret);
+        return ret;
     }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
 }
 
 /**
- * Asynchronously execute a function within the cooperative multitasking environment.
+ * Asynchronously read into several buffers.
  *
- * This function initiates the asynchronous execution of the provided function
- * within the cooperative multitasking environment managed by the given Executor.
- * It creates a new frame, associates the function and data with it, sets it as ready
- * for execution, and increments the frame stack. If the frame stack is at capacity,
- * the function returns an error code.
+ * This static inline function behaves like 'async_read', but scatters the
+ * data into the buffers of 'iov' in order with 'request_readv'. The array may
+ * live on the stack of the frame, which stays suspended until the read
+ * completes.
  *
  * @param executor
- *   A pointer to the Executor structure managing the cooperative multitasking.
- * @param fn
- *   The asynchronous task function to execute within the Executor.
- * @param data
- *   Additional data to be passed to the asynchronous task.
+ *   A pointer to the Executor structure managing the asynchronous read.
+ * @param fd
+ *   The file descriptor to read from.
+ * @param iov
+ *   The array of buffers to read into.
+ * @param count
+ *   The number of buffers in the array.
  * @return
- *   0 on success, -1 on failure (e.g., if the frame stack is at capacity).
+ *   The total number of bytes read on success, or an error code on failure.
  */
-int async_exec(struct Executor *executor, Func fn, void *data);
+static inline ssize_t async_readv(struct Executor *executor, int fd,
+                                  const struct iovec *iov, unsigned count)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_readv(&executor->ioc, fd, iov, count, NULL,
+                            &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("readv request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
 
 /**
- * Initialize the Executor for cooperative multitasking.
+ * Asynchronously write from several buffers.
  *
- * This function initializes the Executor structure for cooperative multitasking.
- * It allocates memory for the frame stack, initializes each frame, sets up the
- * execution stack, and initializes the associated I/O context. The Executor is
- * prepared to manage cooperative multitasking with the specified count of frames
- * and a given capacity. Memory allocations are aligned for performance.
+ * This static inline function behaves like 'async_write', but gathers the
+ * data from the buffers of 'iov' in order with 'request_writev', so a header
+ * and a body take a single request.
  *
  * @param executor
- *   A pointer to the Executor structure to be initialized.
+ *   A pointer to the Executor structure managing the asynchronous write.
+ * @param fd
+ *   The file descriptor to write to.
+ * @param iov
+ *   The array of buffers to write from.
  * @param count
- *   The count of frames to be created in the Executor.
- * @param capacity
- *   The capacity of the Executor for handling asynchronous tasks.
+ *   The number of buffers in the array.
  * @return
- *   0 on success, -1 on failure (e.g., memory allocation failure).
+ *   The total number of bytes written on success, or an error code on
+ *   failure.
  */
-int init_executor(struct Executor *executor, size_t count, size_t capacity);
+static inline ssize_t async_writev(struct Executor *executor, int fd,
+                                   const struct iovec *iov, unsigned count)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_writev(&executor->ioc, fd, iov, count, NULL,
+                             &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("writev request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously send a message on a socket.
+ *
+ * This static inline function sends the message described by 'msg' with
+ * 'request_sendmsg'. MSG_WAITALL sends the whole message before the frame
+ * resumes, and MSG_NOSIGNAL reports a closed peer as -EPIPE.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the asynchronous send.
+ * @param fd
+ *   The socket to send to.
+ * @param msg
+ *   The message header describing the data to send.
+ * @param flags
+ *   MSG_* flags of the send.
+ * @return
+ *   The number of bytes sent on success, or an error code on failure.
+ */
+static inline ssize_t async_sendmsg(struct Executor *executor, int fd,
+                                    const struct msghdr *msg, int flags)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_sendmsg(&executor->ioc, fd, msg, flags, NULL,
+                              &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("sendmsg request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously receive a message on a socket.
+ *
+ * This static inline function receives into the message header 'msg' with
+ * 'request_recvmsg'. With MSG_WAITALL the frame resumes once every buffer
+ * of the message is full, or when the peer closed the connection.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the asynchronous receive.
+ * @param fd
+ *   The socket to receive from.
+ * @param msg
+ *   The message header receiving the data.
+ * @param flags
+ *   MSG_* flags of the receive.
+ * @return
+ *   The number of bytes received on success, 0 when the peer closed the
+ *   connection, or an error code on failure.
+ */
+static inline ssize_t async_recvmsg(struct Executor *executor, int fd,
+                                    struct msghdr *msg, int flags)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_recvmsg(&executor->ioc, fd, msg, flags, NULL,
+                              &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("recvmsg request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously create a socket.
+ *
+ * This static inline function creates a socket with 'request_socket' and
+ * suspends the current frame until the kernel returns its descriptor.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the request.
+ * @param domain
+ *   The communication domain, e.g. AF_INET.
+ * @param type
+ *   The socket type, e.g. SOCK_STREAM.
+ * @param protocol
+ *   The protocol, usually 0.
+ * @return
+ *   The descriptor of the new socket on success, or an error code on
+ *   failure.
+ */
+static inline int async_socket(struct Executor *executor, int domain, int type,
+                               int protocol)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_socket(&executor->ioc, domain, type, protocol, NULL,
+                             &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("socket request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously connect a socket to an address.
+ *
+ * This static inline function connects with 'request_connect', so other
+ * frames keep running while the handshake is in progress. The address may
+ * live on the stack of the current frame.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the request.
+ * @param fd
+ *   The socket to connect.
+ * @param addr
+ *   The address to connect to.
+ * @param addrlen
+ *   The size of the address.
+ * @return
+ *   0 on success, or an error code on failure.
+ */
+static inline int async_connect(struct Executor *executor, int fd,
+                                const struct sockaddr *addr, socklen_t addrlen)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_connect(&executor->ioc, fd, addr, addrlen, NULL,
+                              &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("connect request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously shut down a connection.
+ *
+ * This static inline function shuts down one or both directions of a
+ * connection with 'request_shutdown'.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the request.
+ * @param fd
+ *   The socket to shut down.
+ * @param how
+ *   SHUT_RD, SHUT_WR or SHUT_RDWR.
+ * @return
+ *   0 on success, or an error code on failure.
+ */
+static inline int async_shutdown(struct Executor *executor, int fd, int how)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_shutdown(&executor->ioc, fd, how, NULL, &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("shutdown request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously close a file descriptor.
+ *
+ * This static inline function closes the descriptor with 'request_close',
+ * so a socket that lingers on close does not block the executor.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the request.
+ * @param fd
+ *   The file descriptor to close.
+ * @return
+ *   0 on success, or an error code on failure.
+ */
+static inline int async_close(struct Executor *executor, int fd)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_close(&executor->ioc, fd, NULL, &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("close request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Retrieve a handle on the task running on the current frame.
+ *
+ * @param executor
+ *   A pointer to the Executor structure.
+ * @return
+ *   A handle on the current task.
+ */
+static inline struct TaskHandle current_task(struct Executor *executor)
+{
+    struct Frame *frame = get_current_frame(executor);
+    struct TaskHandle handle = { frame, frame->generation };
+    return handle;
+}
+
+/**
+ * Tell whether the task of a handle is still running.
+ *
+ * @param handle
+ *   A pointer to the TaskHandle structure filled by 'async_spawn'.
+ * @return
+ *   1 if the task has not finished yet, 0 otherwise.
+ */
+static inline int task_running(const struct TaskHandle *handle)
+{
+    return handle->frame && handle->frame->generation == handle->generation;
+}
+
+/**
+ * Asynchronously cancel the request a task is suspended on.
+ *
+ * This static inline function cancels the request in flight of the task
+ * with 'request_cancel', and suspends the current frame until the kernel
+ * answered. The cancelled request completes with -ECANCELED, which resumes
+ * the task, e.g. a connection handler parked in 'async_read' whose client
+ * went away, so that it releases its frame and its token. Tasks suspended
+ * on anything else than a request, such as a sleep, are left alone.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the request.
+ * @param handle
+ *   The handle on the task to cancel.
+ * @return
+ *   0 if the request was cancelled, -ESRCH if the task already finished,
+ *   -EINVAL for the current task, -EALREADY if the task is ready to run or
+ *   its request may still complete, -ENOENT if the task is not suspended on
+ *   a request, or another error code on failure.
+ */
+static inline int async_cancel(struct Executor *executor,
+                               struct TaskHandle handle)
+{
+    if (!task_running(&handle))
+        return -ESRCH;
+
+    struct Frame *frame = get_current_frame(executor);
+    struct Frame *target = handle.frame;
+    if (target == frame)
+        return -EINVAL;
+
+    // Its completion is in: the task resumes with the result anyway.
+    if (target->waiter.is_ready)
+        return -EALREADY;
+
+    int ret;
+    do {
+        ret = request_cancel(&executor->ioc, target->waiter.user_data, NULL,
+                             &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0))
+        return ret;
+
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously wait for a task to finish.
+ *
+ * This static inline function links the current frame in the joiners of the
+ * task, kept in its frame, and suspends it until the task finished. Any
+ * number of tasks can join the same task.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the task.
+ * @param handle
+ *   The handle on the task to wait for.
+ * @return
+ *   0 once the task finished, or -EDEADLK for the current task.
+ */
+static inline int async_join(struct Executor *executor,
+                             struct TaskHandle handle)
+{
+    if (!task_running(&handle))
+        return 0;
+
+    struct Frame *frame = get_current_frame(executor);
+    if (handle.frame == frame)
+        return -EDEADLK;
+
+    frame->next_joiner = handle.frame->joiners;
+    handle.frame->joiners = frame;
+    while (task_running(&handle))
+        suspend_current_frame(executor);
+    return 0;
+}
+
+/**
+ * Initialize an empty task group.
+ *
+ * @param group
+ *   A pointer to the TaskGroup structure to be initialized.
+ */
+static inline void init_task_group(struct TaskGroup *group)
+{
+    group->running = 0;
+    group->finished = 0;
+    group->waiter = NULL;
+    group->wait_all = 0;
+}
+
+/**
+ * Asynchronously wait for all the members of a group to finish.
+ *
+ * This static inline function suspends the current frame until no member of
+ * the group is running, e.g. once a request handler queried all its
+ * backends. The finished members are all reported, so the group can be
+ * reused.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the group.
+ * @param group
+ *   A pointer to the TaskGroup structure.
+ */
+static inline void async_group_wait_all(struct Executor *executor,
+                                        struct TaskGroup *group)
+{
+    while (group->running) {
+        group->waiter = get_current_frame(executor);
+        group->wait_all = 1;
+        suspend_current_frame(executor);
+    }
+
+    group->finished = 0;
+}
+
+/**
+ * Asynchronously wait for the next member of a group to finish.
+ *
+ * This static inline function returns at once if a member finished since
+ * the last call, and suspends the current frame until one does otherwise.
+ * Each finished member is reported once, so the parent can take the first
+ * answer of several backends, or handle the members as they finish.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the group.
+ * @param group
+ *   A pointer to the TaskGroup structure.
+ * @return
+ *   The number of members still running, or -ENOENT if no member is left to
+ *   be reported.
+ */
+static inline ssize_t async_group_wait_any(struct Executor *executor,
+                                           struct TaskGroup *group)
+{
+    while (!group->finished) {
+        if (!group->running)
+            return -ENOENT;
+
+        group->waiter = get_current_frame(executor);
+        group->wait_all = 0;
+        suspend_current_frame(executor);
+    }
+
+    --group->finished;
+    return (ssize_t)group->running;
+}
+
+/**
+ * Asynchronously accept a connection into a slot of the registered file table.
+ *
+ * This static inline function allocates a slot of the table registered with
+ * 'register_files' and waits for a connection to be installed in it, like
+ * 'async_accept'. The slot is given back if the accept fails. The connection
+ * is used with the '*_direct' functions and closed with 'unregister_file'.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the asynchronous accept.
+ * @param fd
+ *   The listening file descriptor.
+ * @return
+ *   The slot holding the connection on success, -ENFILE if every slot is in
+ *   use, or another negative error code on failure.
+ */
+static inline int async_accept_direct(struct Executor *executor, int fd)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int slot = allocate_file_slot(&executor->ioc);
+    if (unlikely(slot < 0))
+        return slot;
+
+    int ret;
+    do {
+        ret = request_accept_direct(&executor->ioc, fd, (uint32_t)slot, NULL,
+                                    &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (likely(ret == 0)) {
+        suspend_current_frame(executor);
+        ret = (int)frame->waiter.result;
+    }
+    if (unlikely(ret < 0)) {
+        release_file_slot(&executor->ioc, (uint32_t)slot);
+        return ret;
+    }
+
+    return slot;
+}
+
+/**
+ * Asynchronously take the next connection accepted by an acceptor.
+ *
+ * This static inline function returns at once while the acceptor has queued
+ * connections, so a burst of connections costs neither a submission nor a
+ * suspension per connection. Otherwise the current frame arms the multishot
+ * accept request of the acceptor if needed, and waits for a connection.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the acceptor's IOContext.
+ * @param acceptor
+ *   A pointer to the Acceptor structure, initialized with init_acceptor on
+ *   the IOContext of the executor.
+ * @return
+ *   The accepted file descriptor, or the error the multishot request ended
+ *   with, reported once.
+ */
+static inline int async_accept_next(struct Executor *executor,
+                                    struct Acceptor *acceptor)
+{
+    struct Frame *frame = get_current_frame(executor);
+    while (acceptor->count == 0) {
+        if (unlikely(acceptor->error < 0)) {
+            int error = acceptor->error;
+            acceptor->error = 0;
+            return error;
+        }
+
+        int ret;
+        do {
+            ret = arm_acceptor(acceptor);
+        } while (unlikely(ret < 0) && retry_request(executor, ret));
+        if (unlikely(ret < 0)) {
+            LOG_ERROR("multishot accept request failed %d", ret);
+            return ret;
+        }
+
+        push_acceptor_waiter(acceptor, &frame->waiter);
+        suspend_current_frame(executor);
+    }
+
+    return pop_accepted(acceptor);
+}
+
+/**
+ * Asynchronously read from a slot of the registered file table.
+ *
+ * This static inline function behaves like 'async_read' on the file held by
+ * the given slot, which saves the kernel the lookup of the file.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the asynchronous read.
+ * @param slot
+ *   The slot of the file to read from.
+ * @param buffer
+ *   A pointer to the buffer where the read data will be stored.
+ * @param size
+ *   The number of bytes to read.
+ * @return
+ *   The number of bytes read on success, or an error code on failure.
+ */
+static inline ssize_t async_read_direct(struct Executor *executor,
+                                        uint32_t slot, void *buffer,
+                                        size_t size)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_read_direct(&executor->ioc, slot, buffer, size, NULL,
+                                  &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("read request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously write to a slot of the registered file table.
+ *
+ * This static inline function behaves like 'async_write' on the file held by
+ * the given slot, which saves the kernel the lookup of the file.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the asynchronous write.
+ * @param slot
+ *   The slot of the file to write to.
+ * @param buffer
+ *   A pointer to the buffer containing the data to be written.
+ * @param size
+ *   The number of bytes to write.
+ * @return
+ *   The number of bytes written on success, or an error code on failure.
+ */
+static inline ssize_t async_write_direct(struct Executor *executor,
+                                         uint32_t slot, void *buffer,
+                                         size_t size)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_write_direct(&executor->ioc, slot, buffer, size, NULL,
+                                   &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("write request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously read into a slice of the registered buffer arena.
+ *
+ * This static inline function behaves like 'async_read', but the buffer is a
+ * slice retrieved with 'acquire_buffer' from the arena of 'register_buffers',
+ * whose pages the kernel does not have to pin for the request.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the asynchronous read.
+ * @param fd
+ *   The file descriptor on which to perform the read operation.
+ * @param buffer
+ *   A pointer inside a slice of the arena.
+ * @param size
+ *   The number of bytes to read, not crossing the end of the slice.
+ * @return
+ *   The number of bytes read on success, or an error code on failure.
+ */
+static inline ssize_t async_read_fixed(struct Executor *executor, int fd,
+                                       void *buffer, size_t size)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_read_fixed(&executor->ioc, fd, buffer, size, NULL,
+                                 &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("read request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously write from a slice of the registered buffer arena.
+ *
+ * This static inline function behaves like 'async_write', but the buffer is
+ * a slice retrieved with 'acquire_buffer' from the arena of
+ * 'register_buffers', whose pages the kernel does not have to pin for the
+ * request.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the asynchronous write.
+ * @param fd
+ *   The file descriptor on which to perform the write operation.
+ * @param buffer
+ *   A pointer inside a slice of the arena.
+ * @param size
+ *   The number of bytes to write, not crossing the end of the slice.
+ * @return
+ *   The number of bytes written on success, or an error code on failure.
+ */
+static inline ssize_t async_write_fixed(struct Executor *executor, int fd,
+                                        void *buffer, size_t size)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_write_fixed(&executor->ioc, fd, buffer, size, NULL,
+                                  &frame->waiter);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("write request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously send a buffer without copying it into the kernel.
+ *
+ * This static inline function issues a zero-copy send and resumes the current
+ * frame as soon as the result is known, while the kernel may still be reading
+ * the buffer. 'release' is called from 'process' once the buffer can be
+ * reused, possibly after this function returned, so the buffer must not live
+ * on the stack of the frame. As 'run' returns with the last task, a task
+ * waits for the release of its last sends before it ends. See
+ * 'request_send_zc'.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the asynchronous send.
+ * @param fd
+ *   The socket to send to.
+ * @param buffer
+ *   A pointer to the data to be sent.
+ * @param size
+ *   The size of the data to be sent.
+ * @param release
+ *   A function called once the buffer can be reused, or NULL.
+ * @param data
+ *   A pointer to user data to be passed to the release function.
+ * @return
+ *   The number of bytes sent on success, or an error code on failure.
+ */
+static inline ssize_t async_send_zc(struct Executor *executor, int fd,
+                                    void *buffer, size_t size,
+                                    release_cb release, void *data)
+{
+    struct Frame *frame = get_current_frame(executor);
+    int ret;
+    do {
+        ret = request_send_zc(&executor->ioc, fd, buffer, size, NULL,
+                              &frame->waiter, release, data);
+    } while (unlikely(ret < 0) && retry_request(executor, ret));
+    if (unlikely(ret < 0)) {
+        LOG_ERROR("send request failed %d", ret);
+        return ret;
+    }
+    suspend_current_frame(executor);
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously receive into a provided buffer picked when data arrives.
+ *
+ * This static inline function issues a receive with buffer selection from the
+ * buffer ring of 'register_buffer_ring', so the current frame does not hold
+ * any buffer while the socket is idle. When the ring is empty, the frame
+ * waits until another task recycles a buffer, then receives again. The
+ * retrieved buffer, see 'provided_buffer', belongs to the caller until it is
+ * given back with 'recycle_buffer'.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the asynchronous receive.
+ * @param fd
+ *   The socket to receive from.
+ * @param buffer_id
+ *   A pointer receiving the id of the buffer holding the data, only set when
+ *   the return value is positive.
+ * @return
+ *   The number of bytes received on success, 0 when the peer closed the
+ *   connection, or an error code on failure.
+ */
+static inline ssize_t async_recv_select(struct Executor *executor, int fd,
+                                        uint16_t *buffer_id)
+{
+    struct Frame *frame = get_current_frame(executor);
+    while (1) {
+        int ret;
+        do {
+            ret = request_recv_select(&executor->ioc, fd, NULL,
+                                      &frame->waiter);
+        } while (unlikely(ret < 0) && retry_request(executor, ret));
+        if (unlikely(ret < 0)) {
+            LOG_ERROR("recv request failed %d", ret);
+            return ret;
+        }
+        suspend_current_frame(executor);
+
+        if (likely(frame->waiter.result != -ENOBUFS))
+            break;
+
+        // The ring may have been refilled since the receive failed.
+        if (executor->ioc.provided.available == 0) {
+            push_buffer_waiter(&executor->ioc, &frame->waiter);
+            suspend_current_frame(executor);
+        }
+    }
+
+    // A buffer picked for an empty or failed receive is given back at once.
+    int id = completion_buffer(frame->waiter.flags);
+    if (unlikely(frame->waiter.result <= 0)) {
+        if (id >= 0)
+            recycle_buffer(&executor->ioc, (uint16_t)id);
+        return frame->waiter.result;
+    }
+
+    *buffer_id = (uint16_t)id;
+    return frame->waiter.result;
+}
+
+/**
+ * Asynchronously take the next chunk of data received by a stream.
+ *
+ * This static inline function returns at once while the stream has queued
+ * chunks. Otherwise the current frame arms the multishot receive of the
+ * stream if needed, and waits for data. When the request ended because the
+ * buffer ring ran dry, the frame waits until a buffer is recycled before it
+ * arms the request again. The buffer holding the chunk, see
+ * 'provided_buffer', belongs to the caller until it is given back with
+ * 'recycle_buffer'.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the stream's IOContext.
+ * @param stream
+ *   A pointer to the RecvStream structure, initialized with init_recv_stream
+ *   on the IOContext of the executor.
+ * @param buffer_id
+ *   A pointer receiving the id of the buffer holding the data, only set when
+ *   the return value is positive.
+ * @return
+ *   The number of bytes received on success, 0 when the peer closed the
+ *   connection, or the error the request ended with, reported once.
+ */
+static inline ssize_t async_recv_next(struct Executor *executor,
+                                      struct RecvStream *stream,
+                                      uint16_t *buffer_id)
+{
+    struct Frame *frame = get_current_frame(executor);
+    while (stream->count == 0) {
+        if (stream->closed)
+            return 0;
+
+        if (unlikely(stream->error < 0)) {
+            int error = stream->error;
+            stream->error = 0;
+            if (error != -ENOBUFS)
+                return error;
+
+            if (executor->ioc.provided.available == 0) {
+                push_buffer_waiter(&executor->ioc, &frame->waiter);
+                suspend_current_frame(executor);
+            }
+            continue;
+        }
+
+        int ret;
+        do {
+            ret = arm_recv_stream(stream);
+        } while (unlikely(ret < 0) && retry_request(executor, ret));
+        if (unlikely(ret < 0)) {
+            LOG_ERROR("multishot recv request failed %d", ret);
+            return ret;
+        }
+
+        stream->waiter = &frame->waiter;
+        suspend_current_frame(executor);
+    }
+
+    return pop_received(stream, buffer_id);
+}
+
+/**
+ * Wrapper function for asynchronous task execution in the Executor.
+ *
+ * This function is the entry point of every frame started by 'async_exec'.
+ * It executes the task function stored in the current frame, typically
+ * performing an asynchronous task, and then manages the completion of the
+ * task by calling the 'manage_async_finish' function. It never returns.
+ *
+ * @param data
+ *   A pointer to the Executor structure managing the cooperative multitasking.
+ */
+void execute(void *data);
+
+/**
+ * Swap the current frame with the last frame in the Executor's frame stack.
+ *
+ * This static inline function swaps the positions of the current frame and the
+ * last frame in the frame stack of the given Executor. If the last frame is not
+ * the same as the current frame, no swap occurs. The function returns a pointer
+ * to the newly positioned current frame after the swap.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the frame stack.
+ * @return
+ *   A pointer to the current frame after the swap, or NULL if no swap occurred.
+ */
+static inline struct Frame *
+swap_current_frame_with_last_frame(struct Executor *executor)
+{
+    struct Frame *current = get_current_frame(executor);
+    struct Frame *last = get_last_frame(executor);
+
+    if (last == current)
+        return NULL;
+
+    struct Frame *tmp = last;
+    executor->frames[executor->size - 1] = current;
+    executor->frames[executor->current] = tmp;
+    current->index = executor->size - 1;
+    tmp->index = executor->current;
+    return executor->frames[executor->current];
+}
+
+/**
+ * Resume the tasks waiting for a finished task.
+ *
+ * This function makes the frames joining the task ready, and reports the
+ * task to its group, whose waiter is made ready once the group has what it
+ * waits for. It is only called for the tasks that have joiners or a group.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the task.
+ * @param finished
+ *   A pointer to the frame of the finished task.
+ */
+void notify_task_finished(struct Executor *executor, struct Frame *finished);
+
+/**
+ * Manage the completion of an asynchronous task in the Executor.
+ *
+ * This static inline function manages the completion of an asynchronous task
+ * within the given Executor. It returns the stack of the finished task to the
+ * stack pool, where it becomes the first stack handed to the next task, swaps
+ * the current frame with the last frame, reduces the frame stack size, and
+ * switches to the next ready frame, or to the main frame if no frame is ready.
+ * The tasks joining the finished task and the waiter of its group, if any,
+ * are made ready first. The function never returns.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the asynchronous task.
+ */
+static inline void manage_async_finish(struct Executor *executor)
+{
+    struct Frame *finished = get_current_frame(executor);
+    ++finished->generation;
+    if (unlikely(finished->joiners || finished->group))
+        notify_task_finished(executor, finished);
+    release_stack(&executor->stacks, &finished->stack);
+    swap_current_frame_with_last_frame(executor);
+    --executor->size;
+
+    finished->waiter.is_ready = 0;
+    struct Frame *next = move_to_next_ready_frame(executor);
+    switch_context(&finished->exe, &next->exe);
+}
+
+/**
+ * Asynchronously execute a function on a stack of the given size.
+ *
+ * This function behaves like 'async_exec', but runs the task on a stack of at
+ * least 'stack_size' bytes. Stacks are mapped with a guard page and committed
+ * lazily by the kernel, so tasks with large stacks can coexist with many tasks
+ * using small ones. The stack is taken from the executor's stack pool, which
+ * hands out the most recently released stack of the matching size class.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the cooperative multitasking.
+ * @param fn
+ *   The asynchronous task function to execute within the Executor.
+ * @param data
+ *   Additional data to be passed to the asynchronous task.
+ * @param stack_size
+ *   The requested stack size in bytes, rounded up to a power of two pages.
+ * @return
+ *   0 on success, -1 on failure (e.g., if the frame limit is reached or
+ *   the stack cannot be mapped).
+ */
+int async_exec_with_stack(struct Executor *executor, Func fn, void *data,
+                          size_t stack_size);
+
+/**
+ * Asynchronously execute a function within the cooperative multitasking environment.
+ *
+ * This function initiates the asynchronous execution of the provided function
+ * within the cooperative multitasking environment managed by the given Executor.
+ * It creates a new frame with a STACK_SIZE stack, associates the function and
+ * data with it, pushes it onto the ready queue, and increments the frame stack.
+ * If every frame is in use, a new chunk of frames is allocated, doubling the
+ * capacity up to the executor's frame limit. Existing frames and stacks never
+ * move. Once the frame limit is reached, the function returns an error code.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the cooperative multitasking.
+ * @param fn
+ *   The asynchronous task function to execute within the Executor.
+ * @param data
+ *   Additional data to be passed to the asynchronous task.
+ * @return
+ *   0 on success, -1 on failure (e.g., if the frame limit is reached).
+ */
+int async_exec(struct Executor *executor, Func fn, void *data);
+
+/**
+ * Asynchronously execute a function and retrieve a handle on the task.
+ *
+ * This function behaves like 'async_exec', and fills a handle that other
+ * tasks use to cancel the task with 'async_cancel'. The handle stays safe to
+ * use after the task finished: it is merely no longer running.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the cooperative multitasking.
+ * @param fn
+ *   The asynchronous task function to execute within the Executor.
+ * @param data
+ *   Additional data to be passed to the asynchronous task.
+ * @param handle
+ *   A pointer to the TaskHandle structure to fill.
+ * @return
+ *   0 on success, -1 on failure (e.g., if the frame limit is reached).
+ */
+int async_spawn(struct Executor *executor, Func fn, void *data,
+                struct TaskHandle *handle);
+
+/**
+ * Asynchronously execute a function as a member of a task group.
+ *
+ * This function behaves like 'async_spawn', and adds the task to the group,
+ * so that the parent waits for it with 'async_group_wait_all' or
+ * 'async_group_wait_any'.
+ *
+ * @param executor
+ *   A pointer to the Executor structure managing the cooperative multitasking.
+ * @param group
+ *   A pointer to the initialized TaskGroup structure.
+ * @param fn
+ *   The asynchronous task function to execute within the Executor.
+ * @param data
+ *   Additional data to be passed to the asynchronous task.
+ * @param handle
+ *   A pointer to the TaskHandle structure to fill, or NULL.
+ * @return
+ *   0 on success, -1 on failure (e.g., if the frame limit is reached).
+ */
+int async_group_spawn(struct Executor *executor, struct TaskGroup *group,
+                      Func fn, void *data, struct TaskHandle *handle);
+
+/**
+ * Initialize the Executor for cooperative multitasking.
+ *
+ * This function initializes the Executor structure for cooperative multitasking.
+ * It allocates memory for the frame stack, initializes each frame, and
+ * initializes the associated I/O context. Execution stacks are taken from the
+ * executor's stack pool when a task is started. The Executor is
+ * prepared to manage cooperative multitasking with the specified count of frames
+ * and a given capacity. Memory allocations are aligned for performance. More
+ * frames are allocated on demand by 'async_exec', up to FRAME_LIMIT tasks
+ * unless changed with 'set_frame_limit'.
+ *
+ * @param executor
+ *   A pointer to the Executor structure to be initialized.
+ * @param count
+ *   The count of frames to be created upfront in the Executor, typically the
+ *   number of tasks expected in the steady state.
+ * @param capacity
+ *   The capacity of the Executor for handling asynchronous tasks.
+ * @return
+ *   0 on success, -1 on failure (e.g., memory allocation failure).
+ */
+int init_executor(struct Executor *executor, size_t count, size_t capacity);
+
+/**
+ * Initialize the Executor with options for its I/O context.
+ *
+ * This function behaves like 'init_executor', but creates the io_uring
+ * instance with the given options. Executors are driven by a single thread,
+ * which is the case IORING_SETUP_SINGLE_ISSUER and IORING_SETUP_DEFER_TASKRUN
+ * are designed for. Flags the kernel does not support are dropped.
+ *
+ * @param executor
+ *   A pointer to the Executor structure to be initialized.
+ * @param count
+ *   The count of frames to be created upfront in the Executor.
+ * @param capacity
+ *   The capacity of the Executor for handling asynchronous tasks.
+ * @param options
+ *   A pointer to the options of the I/O context, or NULL for the defaults.
+ * @return
+ *   0 on success, -1 on failure (e.g., memory allocation failure).
+ */
+int init_executor_with_options(struct Executor *executor, size_t count,
+                               size_t capacity,
+                               const struct IOContextOptions *options);
+
+/**
+ * Set the maximum number of tasks of the Executor.
+ *
+ * The frames array grows on demand until the executor holds 'limit' tasks,
+ * after which 'async_exec' fails. Frames already allocated are kept, even if
+ * they exceed the new limit.
+ *
+ * @param executor
+ *   A pointer to the Executor structure to be configured.
+ * @param limit
+ *   The maximum number of tasks, main frame excluded.
+ * @return
+ *   0 on success, -1 on failure (e.g., if more tasks are already running).
+ */
+int set_frame_limit(struct Executor *executor, size_t limit);
 
 /**
  * Free resources associated with the Executor structure.
  *
  * This function releases resources allocated for the Executor structure,
- * including the I/O context, frame stack memory, and individual frames.
+ * including the I/O context, the stack pool, and individual frames.
  * It ensures proper cleanup to prevent memory leaks.
  *
  * @param executor
@@ -471,10 +1788,16 @@ int free_executor(struct Executor *executor);
 /**
  * Run the cooperative multitasking loop in the Executor.
  *
- * This function enters the cooperative multitasking loop within the given Executor.
- * It iteratively swaps between ready frames, executing asynchronous tasks and processing
- * I/O events using the specified batch size. The loop continues until there is only one
- * remaining frame in the Executor, at which point it breaks out of the loop.
+ * This function enters the cooperative multitasking loop within the given
+ * Executor. Each turn, it resumes frames from the ready queue, which run until
+ * every one of them is suspended. It then keeps a single wakeup timeout in
+ * flight for the nearest timer with request_wakeup, and processes I/O events
+ * with process, which blocks until a completion or the wakeup arrives. When
+ * the wakeup cannot be armed, e.g. on a full submission queue, it processes
+ * the ready completions with process_nowait instead, so that it never blocks
+ * past a timer. Finally, it fires the expired timers with
+ * advance_timer_wheel. The loop continues until there is only one remaining
+ * frame in the Executor, at which point it breaks out of the loop.
  *
  * @param executor
  *   A pointer to the Executor structure managing cooperative multitasking.
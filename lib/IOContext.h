@@ -5,18 +5,52 @@
 extern "C" {
 #endif
 
+#include <errno.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <liburing.h>
 
 #include "Common.h"
 
 #define MAX_BATCH_SIZE 1024
+#define NO_FILE_SLOT UINT32_MAX
+#define MAX_BUFFER_SLICES 16384
+#define MAX_RING_BUFFERS 32768
+#define BUFFER_RING_GROUP 0
+#define WAKEUP_USER_DATA (UINT64_MAX - 1)
+#define WAKEUP_UPDATE_USER_DATA (UINT64_MAX - 2)
+#define LINK_TIMEOUT_USER_DATA (UINT64_MAX - 3)
+#define NO_USER_DATA UINT64_MAX
+#define TOKEN_DEADLINE 1
+
+/* Setup flags missing from the headers of older liburing releases. */
+#ifndef IORING_SETUP_COOP_TASKRUN
+#define IORING_SETUP_COOP_TASKRUN (1U << 8)
+#endif
+#ifndef IORING_SETUP_TASKRUN_FLAG
+#define IORING_SETUP_TASKRUN_FLAG (1U << 9)
+#endif
+#ifndef IORING_SETUP_SINGLE_ISSUER
+#define IORING_SETUP_SINGLE_ISSUER (1U << 12)
+#endif
+#ifndef IORING_SETUP_DEFER_TASKRUN
+#define IORING_SETUP_DEFER_TASKRUN (1U << 13)
+#endif
+#ifndef IORING_SQ_TASKRUN
+#define IORING_SQ_TASKRUN (1U << 2)
+#endif
 
 typedef void (*wait_cb)(void * /*data*/);
 typedef void (*accept_cb)(int /*fd*/, void * /*data*/);
 typedef void (*read_cb)(ssize_t /*read length*/, void * /*data*/);
 typedef void (*write_cb)(ssize_t /*write length*/, void * /*data*/);
+typedef void (*recv_cb)(ssize_t /*recv length*/, int /*buffer id*/,
+                        void * /*data*/);
+typedef void (*multishot_cb)(int /*result*/, uint32_t /*cqe flags*/,
+                             void * /*data*/);
+typedef void (*release_cb)(void * /*data*/);
+typedef void (*status_cb)(int /*result*/, void * /*data*/);
 typedef void (*Cb)(void);
 
 /**
@@ -34,8 +68,68 @@ typedef void (*Cb)(void);
  *   to a file descriptor or socket.
  * - `WAIT (8)`: Represents a wait operation, indicating a task that waits for a specific
  *   condition or event to occur.
+ * - `RECV (16)`: Represents a receive into a buffer the kernel picks from the
+ *   provided buffer ring when data arrives.
+ * - `MULTISHOT (32)`: Represents a request producing several completions, whose
+ *   callback gets the flags of each of them, IORING_CQE_F_MORE included.
+ * - `SEND_ZC (64)`: Represents a zero-copy send, completed once with its result
+ *   and once more with a notification when the kernel released the buffer.
+ * - `READV (128)`: Represents a read scattered into an array of buffers.
+ * - `WRITEV (256)`: Represents a write gathered from an array of buffers.
+ * - `SENDMSG (512)`: Represents a send of a message header, with its buffers,
+ *   address and control data.
+ * - `RECVMSG (1024)`: Represents a receive into a message header.
+ * - `CONNECT (2048)`: Represents the connection of a socket to an address.
+ * - `SOCKET (4096)`: Represents the creation of a socket.
+ * - `CLOSE (8192)`: Represents the closing of a file descriptor.
+ * - `SHUTDOWN (16384)`: Represents the shutdown of one or both directions of
+ *   a connection.
+ * - `CANCEL (32768)`: Represents the cancellation of a request in flight.
+ */
+enum RequestType {
+    ACCEPT = 1,
+    READ = 2,
+    WRITE = 4,
+    WAIT = 8,
+    RECV = 16,
+    MULTISHOT = 32,
+    SEND_ZC = 64,
+    READV = 128,
+    WRITEV = 256,
+    SENDMSG = 512,
+    RECVMSG = 1024,
+    CONNECT = 2048,
+    SOCKET = 4096,
+    CLOSE = 8192,
+    SHUTDOWN = 16384,
+    CANCEL = 32768
+};
+
+/**
+ * @struct Waiter
+ * @brief Represents a suspended task waiting for the completion of a request.
+ *
+ * A Waiter is passed as the data of a request issued without a callback. On
+ * completion, `process` stores the result of the operation in it and appends
+ * it to the ready queue of the IOContext, without any indirect call.
+ *
+ * - `struct Waiter *next`: Link to the next waiter in the ready queue.
+ * - `ssize_t result`: Result of the completed operation (cqe->res).
+ * - `int is_ready`: Flag indicating whether the waiter is queued or running.
+ * - `uint32_t flags`: Flags of the completion (cqe->flags), e.g. the id of the
+ *    provided buffer a receive picked. See completion_buffer.
+ * - `uint64_t user_data`: The user_data of the last request issued for the
+ *    waiter, or NO_USER_DATA. Completions of older requests are stale, e.g.
+ *    those of a request left behind by the finished task of a recycled frame,
+ *    and `process` drops them.
  */
-enum RequestType { ACCEPT = 1, READ = 2, WRITE = 4, WAIT = 8 };
+struct Waiter {
+    struct Waiter *next;
+    ssize_t result;
+    int is_ready;
+    uint32_t flags;
+    uint64_t user_data;
+};
 
 /**
  * @struct Token
@@ -44,22 +138,265 @@ enum RequestType { ACCEPT = 1, READ = 2, WRITE = 4, WAIT = 8 };
  * The Token structure encapsulates information about an asynchronous task,
  * providing a convenient way to pass relevant data within the Cring library.
  *
- * - `int fd`: File descriptor associated with the asynchronous task.
- * - `enum RequestType type`: Type of asynchronous request, defining the nature
- *    of the operation (e.g., ACCEPT, READ, WRITE, WAIT).
- * - `Cb cb`: Callback function to be executed upon completion of the asynchronous task.
+ * - `Cb cb`: Callback function to be executed upon completion of the asynchronous task,
+ *    or NULL if `data` is a Waiter to be resumed directly.
  * - `void *data`: Additional data associated with the task, providing flexibility
  *    for user-specific information.
+ * - `int fd`: File descriptor associated with the asynchronous task, or the slot
+ *    in the registered file table for the requests on direct descriptors.
+ * - `enum RequestType type`: Type of asynchronous request, defining the nature
+ *    of the operation (e.g., ACCEPT, READ, WRITE, WAIT).
+ * - `uint32_t generation`: Incremented each time the token is released, so that
+ *    a stale user_data can be told apart from the current use of the token.
+ * - `uint32_t flags`: TOKEN_DEADLINE if a linked timeout guards the request,
+ *    whose cancellation is then reported as -ETIME.
  *
- * The structure is packed to ensure minimal memory overhead. Users can leverage
- * Token instances when interacting with the Cring library to handle asynchronous tasks.
+ * Tokens live in a cache-line aligned slab and are 32 bytes each, so a token
+ * never straddles two cache lines and its pointers are naturally aligned.
+ * Users can leverage Token instances when interacting with the Cring library
+ * to handle asynchronous tasks.
  */
 struct Token {
+    Cb cb;
+    void *data;
     int fd;
     enum RequestType type;
-    Cb cb;
+    uint32_t generation;
+    uint32_t flags;
+} __attribute__((aligned(32)));
+
+/**
+ * @struct IOContextOptions
+ * @brief Options controlling the setup of the io_uring instance of an IOContext.
+ *
+ * - `uint32_t flags`: IORING_SETUP_* flags requested for the ring, e.g.
+ *    IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN for a ring used by
+ *    a single thread, IORING_SETUP_COOP_TASKRUN or IORING_SETUP_CLAMP.
+ *    IORING_SETUP_DEFER_TASKRUN implies IORING_SETUP_SINGLE_ISSUER.
+ * - `uint32_t cq_entries`: Size of the completion queue, or 0 for the kernel
+ *    default of twice the submission queue. Sets IORING_SETUP_CQSIZE.
+ * - `uint32_t sq_thread_idle`: With IORING_SETUP_SQPOLL, milliseconds the kernel
+ *    polling thread spins without work before it goes to sleep.
+ * - `uint32_t sq_thread_cpu`: With IORING_SETUP_SQPOLL | IORING_SETUP_SQ_AFF, the
+ *    CPU the kernel polling thread is bound to.
+ * - `uint32_t wait_completions`: Completions process waits for when none is ready,
+ *    or 0 for 1. See set_wait_policy.
+ * - `uint32_t wait_timeout_us`: Longest wait for these completions in microseconds,
+ *    or 0 to wait without a timeout.
+ * - `uint32_t spin_ns`: Longest time process spins for a completion before it
+ *    sleeps in the kernel, or 0 to never spin. See set_spin_policy.
+ *
+ * With IORING_SETUP_SQPOLL a kernel thread consumes the submission queue, so
+ * submitting requests does not enter the kernel while the thread is awake.
+ * Flags unknown to the running kernel are dropped, in the order DEFER_TASKRUN,
+ * SINGLE_ISSUER, COOP_TASKRUN and SQPOLL, until the ring can be created.
+ * SQPOLL is also dropped when the process lacks the privileges it needs on
+ * older kernels. The flags in effect are stored in the `setup_flags` field
+ * of the IOContext.
+ */
+struct IOContextOptions {
+    uint32_t flags;
+    uint32_t cq_entries;
+    uint32_t sq_thread_idle;
+    uint32_t sq_thread_cpu;
+    uint32_t wait_completions;
+    uint32_t wait_timeout_us;
+    uint32_t spin_ns;
+};
+
+/**
+ * @struct IOStats
+ * @brief Counters describing the pressure on the resources of an IOContext.
+ *
+ * - `uint64_t sq_flushes`: Number of times a full submission queue was flushed on demand.
+ * - `uint64_t sq_wakeups`: Number of times a sleeping SQPOLL thread had to be woken up.
+ * - `uint64_t enters`: Number of times process entered the kernel to submit or wait.
+ * - `uint64_t wait_timeouts`: Number of waits ended by the timeout of the wait policy.
+ * - `uint64_t spins`: Number of times process spun for a completion.
+ * - `uint64_t spin_hits`: Number of spins that saw a completion before running out of budget.
+ * - `uint64_t spin_ns`: Total time spent spinning, in nanoseconds.
+ * - `uint64_t sleeps`: Number of times process slept in the kernel for a completion.
+ * - `uint64_t sleep_ns`: Total time spent sleeping in the kernel, in nanoseconds.
+ * - `uint64_t token_waits`: Number of times a task waited for a token.
+ * - `uint64_t token_wait_ns`: Total time tasks spent waiting for a token, in nanoseconds.
+ * - `uint64_t token_wait_max_ns`: Longest single wait for a token, in nanoseconds.
+ * - `uint64_t zc_sends`: Number of zero-copy sends notified as released.
+ * - `uint64_t zc_copied`: Number of zero-copy sends the kernel fell back to
+ *    copying, e.g. on loopback.
+ * - `uint64_t deadlines_expired`: Number of requests cancelled by their linked
+ *    timeout.
+ */
+struct IOStats {
+    uint64_t sq_flushes;
+    uint64_t sq_wakeups;
+    uint64_t enters;
+    uint64_t wait_timeouts;
+    uint64_t spins;
+    uint64_t spin_hits;
+    uint64_t spin_ns;
+    uint64_t sleeps;
+    uint64_t sleep_ns;
+    uint64_t token_waits;
+    uint64_t token_wait_ns;
+    uint64_t token_wait_max_ns;
+    uint64_t zc_sends;
+    uint64_t zc_copied;
+    uint64_t deadlines_expired;
+};
+
+/**
+ * @struct BufferArena
+ * @brief Represents the buffers registered with the ring of an IOContext.
+ *
+ * The arena is a single mapping cut into slices of the same size. Every slice
+ * is registered as its own buffer, so the index of a slice is the buf_index of
+ * the fixed requests using it and the kernel never pins or unpins its pages
+ * per request. Free slices are kept in a LIFO stack, like tokens.
+ *
+ * - `uint8_t *memory`: Start of the arena, NULL if no buffer is registered.
+ * - `size_t slice_size`: Size of a slice in bytes, a multiple of CACHE_LINE_SIZE.
+ * - `uint32_t count`: Number of slices of the arena.
+ * - `uint32_t tail`: Number of available slices, top of the `free_slices` stack.
+ * - `uint32_t *free_slices`: Stack of the indices of the available slices.
+ */
+struct BufferArena {
+    uint8_t *memory;
+    size_t slice_size;
+    uint32_t count;
+    uint32_t tail;
+    uint32_t *free_slices;
+};
+
+/**
+ * @struct BufferRing
+ * @brief Represents the provided buffers the kernel picks from for receives.
+ *
+ * A receive with buffer selection does not hold any memory while it waits:
+ * the kernel takes the next buffer of the ring only when data arrives, and
+ * reports its id in the completion. The owner of the data gives the buffer
+ * back with recycle_buffer. Tasks whose receive found the ring empty park in
+ * a FIFO queue until a buffer is recycled.
+ *
+ * - `struct io_uring_buf_ring *ring`: Ring shared with the kernel, NULL if none
+ *    is registered.
+ * - `uint8_t *memory`: Start of the buffers, `count` times `buffer_size` bytes.
+ * - `size_t buffer_size`: Size of a buffer in bytes.
+ * - `uint32_t count`: Number of buffers, a power of two.
+ * - `uint32_t available`: Number of buffers in the ring the kernel can pick.
+ * - `struct Waiter *wait_head`: First waiter parked until a buffer is recycled.
+ * - `struct Waiter *wait_tail`: Last waiter parked until a buffer is recycled.
+ */
+struct BufferRing {
+    struct io_uring_buf_ring *ring;
+    uint8_t *memory;
+    size_t buffer_size;
+    uint32_t count;
+    uint32_t available;
+    struct Waiter *wait_head;
+    struct Waiter *wait_tail;
+};
+
+/**
+ * @struct Acceptor
+ * @brief Represents a queue of connections accepted by a multishot request.
+ *
+ * A single armed accept request produces a completion per connection. The
+ * accepted descriptors are queued, and tasks take them from the queue with
+ * async_accept_next, without any submission per connection. When the kernel
+ * ends the request, e.g. on an error, it is armed again by the next task
+ * waiting for a connection.
+ *
+ * - `struct IOContext *ioc`: The IOContext the request is armed on.
+ * - `int fd`: The listening socket.
+ * - `int error`: Error the request ended with, reported to the next task.
+ * - `int armed`: Flag indicating whether the request is in flight.
+ * - `int *fds`: Circular queue of the accepted descriptors.
+ * - `uint32_t capacity`: Number of descriptors the queue can hold before it
+ *    grows.
+ * - `uint32_t head`: Position of the oldest descriptor in the queue.
+ * - `uint32_t count`: Number of queued descriptors.
+ * - `uint64_t arms`: Number of times the request was submitted.
+ * - `uint64_t accepted`: Number of accepted connections.
+ * - `uint64_t dropped`: Connections closed because the queue could not grow.
+ * - `struct Waiter *wait_head`: First task waiting for a connection.
+ * - `struct Waiter *wait_tail`: Last task waiting for a connection.
+ */
+struct Acceptor {
+    struct IOContext *ioc;
+    int fd;
+    int error;
+    int armed;
+    int *fds;
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    uint64_t arms;
+    uint64_t accepted;
+    uint64_t dropped;
+    struct Waiter *wait_head;
+    struct Waiter *wait_tail;
+};
+
+/**
+ * @struct Received
+ * @brief Represents data received into a provided buffer by a RecvStream.
+ *
+ * - `int32_t length`: Number of bytes received.
+ * - `uint16_t buffer`: Id of the provided buffer holding them.
+ */
+struct Received {
+    int32_t length;
+    uint16_t buffer;
+};
+
+/**
+ * @struct Release
+ * @brief Represents the callback releasing the buffer of a zero-copy send.
+ *
+ * - `release_cb cb`: Function called once the kernel no longer reads the
+ *    buffer, or NULL.
+ * - `void *data`: A pointer to user data passed to the function.
+ */
+struct Release {
+    release_cb cb;
     void *data;
-} __attribute__((packed));
+};
+
+/**
+ * @struct RecvStream
+ * @brief Represents the data received on a socket by a multishot request.
+ *
+ * A single armed receive produces a completion per chunk of data, each into
+ * a provided buffer of the ring of the IOContext. The chunks are queued in
+ * order, and the task owning the stream takes them with async_recv_next.
+ * When the kernel ends the request, e.g. once the buffer ring ran dry, it is
+ * armed again by the next async_recv_next finding the queue empty.
+ *
+ * - `struct IOContext *ioc`: The IOContext the request is armed on.
+ * - `int fd`: The socket to receive from.
+ * - `int error`: Error the request ended with, reported to the owner.
+ * - `int closed`: Flag indicating whether the peer closed the connection.
+ * - `int armed`: Flag indicating whether the request is in flight.
+ * - `struct Received *chunks`: Circular queue of the received chunks.
+ * - `uint32_t capacity`: Number of chunks the queue can hold before it grows.
+ * - `uint32_t head`: Position of the oldest chunk in the queue.
+ * - `uint32_t count`: Number of queued chunks.
+ * - `uint64_t arms`: Number of times the request was submitted.
+ * - `struct Waiter *waiter`: The owner waiting for data, or NULL.
+ */
+struct RecvStream {
+    struct IOContext *ioc;
+    int fd;
+    int error;
+    int closed;
+    int armed;
+    struct Received *chunks;
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    uint64_t arms;
+    struct Waiter *waiter;
+};
 
 /**
  * @struct IOContext
@@ -68,11 +405,39 @@ struct Token {
  * The IOContext structure manages the underlying io_uring instance and
  * additional information required for handling asynchronous I/O operations.
  *
- * - `uint32_t tail`: Tail index used in the circular buffer of the io_uring instance.
+ * - `uint32_t tail`: Number of available tokens, top of the `free_tokens` stack.
  * - `struct io_uring ring`: The io_uring instance responsible for managing I/O operations.
  * - `uint32_t capacity`: Maximum capacity of the circular buffer in the io_uring instance.
- * - `struct Token **available_tokens`: Array of pointers to available Token instances,
- *    used for associating tasks with I/O operations.
+ * - `uint32_t setup_flags`: IORING_SETUP_* flags the ring was created with.
+ * - `struct Token *tokens`: Slab of tokens, used for associating tasks with I/O operations.
+ *    A token is addressed by its index, which is stored in the user_data of its sqe.
+ * - `uint32_t *free_tokens`: Stack of the indices of the available tokens.
+ * - `struct Waiter *ready_head`: First waiter of the FIFO queue of ready waiters.
+ * - `struct Waiter *ready_tail`: Last waiter of the FIFO queue of ready waiters.
+ * - `struct Waiter *sq_wait_head`: First waiter parked until the submission queue has room.
+ * - `struct Waiter *sq_wait_tail`: Last waiter parked until the submission queue has room.
+ * - `struct Waiter *token_wait_head`: First waiter parked until a token is available.
+ * - `struct Waiter *token_wait_tail`: Last waiter parked until a token is available.
+ * - `uint32_t token_reserved`: Available tokens promised to woken token waiters.
+ * - `uint32_t wait_completions`: Completions process waits for when none is ready.
+ * - `struct __kernel_timespec wait_timeout`: Longest wait for these completions,
+ *    zero to wait without a timeout.
+ * - `uint32_t spin_max_ns`: Longest time to spin for a completion, 0 to never spin.
+ * - `uint32_t spin_budget_ns`: Time the next wait spins for, adapted to `wait_gap_ns`.
+ * - `uint64_t wait_gap_ns`: Moving average of the time waited for a completion.
+ * - `uint32_t file_slots`: Number of slots in the registered file table, 0 if none.
+ * - `uint32_t kernel_file_slots`: Slots at the end of the table the kernel allocates
+ *    for multishot accept requests.
+ * - `uint32_t file_tail`: Number of available slots, top of the `free_files` stack.
+ * - `uint32_t *free_files`: Stack of the available slots allocated by the IOContext.
+ * - `struct BufferArena buffers`: Buffers registered for fixed reads and writes.
+ * - `struct BufferRing provided`: Buffers provided to the kernel for receives.
+ * - `struct Release *releases`: Release callback of the zero-copy send holding
+ *    each token, indexed like `tokens` and allocated by the first such send.
+ * - `uint64_t wakeup_ns`: Deadline of the wakeup timeout in flight, 0 if none.
+ * - `struct __kernel_timespec wakeup_ts`: The same deadline, read by the kernel
+ *    when the timeout is submitted.
+ * - `struct IOStats stats`: Counters of the pressure on the submission queue and tokens.
  *
  * The IOContext structure provides a central component for handling I/O operations
  * within the Cring library. Users interact with this structure when scheduling and
@@ -82,7 +447,31 @@ struct IOContext {
     uint32_t tail;
     struct io_uring ring;
     uint32_t capacity;
-    struct Token **available_tokens;
+    uint32_t setup_flags;
+    struct Token *tokens;
+    uint32_t *free_tokens;
+    struct Waiter *ready_head;
+    struct Waiter *ready_tail;
+    struct Waiter *sq_wait_head;
+    struct Waiter *sq_wait_tail;
+    struct Waiter *token_wait_head;
+    struct Waiter *token_wait_tail;
+    uint32_t token_reserved;
+    uint32_t wait_completions;
+    struct __kernel_timespec wait_timeout;
+    uint32_t spin_max_ns;
+    uint32_t spin_budget_ns;
+    uint64_t wait_gap_ns;
+    uint32_t file_slots;
+    uint32_t kernel_file_slots;
+    uint32_t file_tail;
+    uint32_t *free_files;
+    struct BufferArena buffers;
+    struct BufferRing provided;
+    struct Release *releases;
+    uint64_t wakeup_ns;
+    struct __kernel_timespec wakeup_ts;
+    struct IOStats stats;
 };
 
 /**
@@ -112,12 +501,82 @@ int free_io_context(struct IOContext *ioc);
  */
 int init_io_context(struct IOContext *ioc, size_t capacity);
 
+/**
+ * Initialize the IOContext structure with the specified capacity and options.
+ *
+ * This function behaves like init_io_context, but creates the ring with the
+ * setup flags and completion queue size of the given options, and applies
+ * their wait and spin policies. Setup flags the kernel does not support are dropped
+ * instead of failing.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure to be initialized.
+ * @param capacity
+ *   The desired capacity for the IOContext, representing the maximum number
+ *   of tokens in the ring.
+ * @param options
+ *   A pointer to the options of the ring, or NULL for the defaults.
+ * @return
+ *   0 on success, -1 on failure.
+ */
+int init_io_context_with_options(struct IOContext *ioc, size_t capacity,
+                                 const struct IOContextOptions *options);
+
+/**
+ * Set how long process blocks when no completion is ready.
+ *
+ * process submits the pending requests and waits for completions in a single
+ * io_uring_submit_and_wait_timeout call. It returns once `completions`
+ * completions are ready, at most as many as requests are in flight, or once
+ * `timeout_us` microseconds have passed. Waiting for several completions
+ * lets a loaded ring serve a whole batch per system call, while the timeout
+ * bounds the latency this adds to a lone request.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param completions
+ *   The number of completions to wait for, at least 1.
+ * @param timeout_us
+ *   The longest wait in microseconds, or 0 to wait without a timeout. A
+ *   timeout is required to wait for more than one completion.
+ * @return
+ *   0 on success, -1 on an invalid policy.
+ */
+int set_wait_policy(struct IOContext *ioc, uint32_t completions,
+                    uint32_t timeout_us);
+
+/**
+ * Set how long process spins for a completion before it sleeps in the kernel.
+ *
+ * When no completion is ready, process polls the tail of the completion queue
+ * in userspace, with a pause instruction in the loop, before falling back to
+ * the wait policy. This saves the wakeup latency of the kernel when the
+ * completion arrives quickly, at the cost of burning CPU. The time spent
+ * spinning adapts to the recent completion rate: it is twice the moving
+ * average of the time waited for a completion, up to `max_ns`, and spinning
+ * stops while completions arrive more slowly than `max_ns`.
+ *
+ * On a ring created with IORING_SETUP_DEFER_TASKRUN, completions are only
+ * posted when the thread enters the kernel, so spinning is disabled.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param max_ns
+ *   The longest time to spin in nanoseconds, or 0 to never spin.
+ * @return
+ *   0 on success, -1 on failure.
+ */
+int set_spin_policy(struct IOContext *ioc, uint32_t max_ns);
+
 /**
  * Get a token from the IOContext's available tokens.
  *
  * This function retrieves a token from the available tokens in the IOContext.
- * Tokens are used as user_data, pass to sqe, and retrive in completion time.
- * The function decreases the tail index to mark the token as in use.
+ * Tokens are encoded as user_data with token_user_data, passed to the sqe,
+ * and retrieved at completion time with token_from_user_data. The function
+ * decreases the tail index to mark the token as in use. Tokens reserved for
+ * woken token waiters are not handed out, so that waiters are served in FIFO
+ * order before new requests.
  *
  * @param ioc
  *   A pointer to the IOContext structure from which to get a token.
@@ -126,22 +585,58 @@ int init_io_context(struct IOContext *ioc, size_t capacity);
  */
 static inline struct Token *get_token(struct IOContext *ioc)
 {
-    if (likely(ioc->tail != 0)) {
-        struct Token *token = ioc->available_tokens[--ioc->tail];
-        return token;
-    }
+    if (likely(ioc->tail > ioc->token_reserved))
+        return &ioc->tokens[ioc->free_tokens[--ioc->tail]];
+
 
     LOG_DEBUG("Run out of tokens. tail: %u, capacity: %u\n", ioc->tail,
               ioc->capacity);
     return NULL;
 }
 
+/**
+ * Resume the tasks waiting for a token, in FIFO order.
+ *
+ * This function moves token waiters to the ready queue as long as tokens are
+ * available, reserving one token for each of them. A woken task gives up its
+ * reservation right before retrying its request.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure owning the token waiters.
+ */
+void wake_token_waiters(struct IOContext *ioc);
+
+/**
+ * Park a waiter until a token is available.
+ *
+ * This static inline function appends the waiter to the FIFO queue of waiters
+ * whose request failed with -ENOBUFS. It is resumed by wake_token_waiters once
+ * a token is released, with a token reserved for it in 'token_reserved'.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure owning the queue.
+ * @param waiter
+ *   A pointer to the waiter to be parked.
+ */
+static inline void push_token_waiter(struct IOContext *ioc,
+                                     struct Waiter *waiter)
+{
+    waiter->next = NULL;
+    if (ioc->token_wait_tail)
+        ioc->token_wait_tail->next = waiter;
+    else
+        ioc->token_wait_head = waiter;
+    ioc->token_wait_tail = waiter;
+}
+
 /**
  * Release a token back to the IOContext's available tokens.
  *
  * This function releases a token back to the available tokens in the IOContext.
- * The token becomes available for reuse, and the tail index is increased to
- * reflect the updated available token count.
+ * The token becomes available for reuse, its generation is increased so that
+ * the user_data of its previous use no longer resolves to it, and the tail
+ * index is increased to reflect the updated available token count. Tasks
+ * waiting for a token are resumed.
  *
  * @param ioc
  *   A pointer to the IOContext structure to which the token will be released.
@@ -156,129 +651,1360 @@ static inline void release_token(struct IOContext *ioc, struct Token *token)
         return;
     }
 
-    ioc->available_tokens[ioc->tail] = token;
-    ++ioc->tail;
+    if (unlikely(++token->generation == 0))
+        token->generation = 1;
+    ioc->free_tokens[ioc->tail++] = (uint32_t)(token - ioc->tokens);
+
+    if (unlikely(ioc->token_wait_head != NULL))
+        wake_token_waiters(ioc);
 }
 
 /**
- * Initiate a wait request using io_uring for the specified duration.
+ * Release a batch of tokens back to the IOContext's available tokens.
  *
- * This function prepares a wait request using io_uring for the specified duration,
- * associating it with a token and callback function. The token is acquired using
- * the get_token function. If the token cannot be obtained, the function returns -1.
- * The function sets up the necessary io_uring_sqe for the wait operation and assigns
- * the provided callback function and data to the token.
+ * This function behaves like release_token for every index of the batch, but
+ * appends the whole batch to the stack of available tokens at once. It is
+ * used by process to give back the tokens of a batch of completions.
  *
  * @param ioc
- *   A pointer to the IOContext structure representing the io_uring context.
- * @param ts
- *   A pointer to the __kernel_timespec structure specifying the duration to wait.
- * @param cb
- *   A callback function to be executed when the wait operation completes.
- * @param data
- *   A pointer to user data to be passed to the callback function.
+ *   A pointer to the IOContext structure to which the tokens will be released.
+ * @param indices
+ *   The indices of the tokens that need to be released.
+ * @param count
+ *   The number of indices in the batch.
+ */
+static inline void release_tokens(struct IOContext *ioc,
+                                  const uint32_t *indices, uint32_t count)
+{
+    if (unlikely(count > ioc->capacity - ioc->tail)) {
+        LOG_DEBUG("tokens bag gets full. tail: %u, capacity: %u\n", ioc->tail,
+                  ioc->capacity);
+        count = ioc->capacity - ioc->tail;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        struct Token *token = &ioc->tokens[indices[i]];
+        if (unlikely(++token->generation == 0))
+            token->generation = 1;
+    }
+
+    memcpy(&ioc->free_tokens[ioc->tail], indices, count * sizeof(uint32_t));
+    ioc->tail += count;
+
+    if (unlikely(ioc->token_wait_head != NULL))
+        wake_token_waiters(ioc);
+}
+
+/**
+ * Allocate a slot of the registered file table.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
  * @return
- *   0 on success, -1 on failure. Returns -1 if a token cannot be obtained or if
- *   there is an issue with io_uring_sqe setup.
+ *   The slot on success, or -ENFILE if every slot is in use.
  */
-int request_wait(struct IOContext *ioc, struct __kernel_timespec *ts,
-                 wait_cb cb, void *data);
+static inline int allocate_file_slot(struct IOContext *ioc)
+{
+    if (unlikely(ioc->file_tail == 0))
+        return -ENFILE;
+
+    return (int)ioc->free_files[--ioc->file_tail];
+}
 
 /**
- * Initiate an accept request using io_uring for the specified file descriptor.
+ * Give back a slot of the registered file table allocated with
+ * allocate_file_slot, without touching the file it may hold.
  *
- * This function prepares an accept request using io_uring for the specified file descriptor,
- * associating it with a token and callback function. The token is acquired using the get_token
- * function. If the token cannot be obtained, the function returns -1. The function sets up
- * the necessary io_uring_sqe for the accept operation and assigns the provided callback function,
- * file descriptor, and data to the token.
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param slot
+ *   The slot to be released.
+ */
+static inline void release_file_slot(struct IOContext *ioc, uint32_t slot)
+{
+    if (unlikely(ioc->file_tail + ioc->kernel_file_slots >= ioc->file_slots)) {
+        LOG_DEBUG("file slots get full. tail: %u, slots: %u\n",
+                  ioc->file_tail, ioc->file_slots);
+        return;
+    }
+
+    ioc->free_files[ioc->file_tail++] = slot;
+}
+
+/**
+ * Retrieve a free slice of the registered buffer arena.
  *
  * @param ioc
- *   A pointer to the IOContext structure representing the io_uring context.
- * @param fd
- *   The file descriptor for which the accept operation is initiated.
- * @param cb
- *   A callback function to be executed when the accept operation completes.
- * @param data
- *   A pointer to user data to be passed to the callback function.
+ *   A pointer to the IOContext structure.
  * @return
- *   0 on success, -1 on failure. Returns -1 if a token cannot be obtained or if
- *   there is an issue with io_uring_sqe setup.
+ *   A pointer to `buffers.slice_size` bytes usable by the fixed requests, or
+ *   NULL if every slice is in use.
  */
-int request_accept(struct IOContext *ioc, int fd, accept_cb cb, void *data);
+static inline void *acquire_buffer(struct IOContext *ioc)
+{
+    struct BufferArena *arena = &ioc->buffers;
+    if (unlikely(arena->tail == 0))
+        return NULL;
+
+    uint32_t index = arena->free_slices[--arena->tail];
+    return arena->memory + (size_t)index * arena->slice_size;
+}
 
 /**
- * Initiate a read request using io_uring for the specified file descriptor.
- *
- * This function prepares a read request using io_uring for the specified file descriptor,
- * associating it with a token and callback function. The token is acquired using the get_token
- * function. If the token cannot be obtained, the function returns -1. The function sets up
- * the necessary io_uring_sqe for the read operation and assigns the provided callback function,
- * file descriptor, buffer, size, and data to the token.
+ * Retrieve the index of the slice of the registered buffer arena holding an
+ * address.
  *
  * @param ioc
- *   A pointer to the IOContext structure representing the io_uring context.
- * @param fd
- *   The file descriptor from which to read.
+ *   A pointer to the IOContext structure.
  * @param buffer
- *   A pointer to the buffer where the read data will be stored.
- * @param size
- *   The size of the buffer.
- * @param cb
- *   A callback function to be executed when the read operation completes.
- * @param data
- *   A pointer to user data to be passed to the callback function.
+ *   An address inside the arena.
  * @return
- *   0 on success, -1 on failure. Returns -1 if a token cannot be obtained or if
- *   there is an issue with io_uring_sqe setup.
+ *   The index of the slice, or -1 if the address is out of the arena.
  */
-int request_read(struct IOContext *ioc, int fd, void *buffer, size_t size,
-                 read_cb cb, void *data);
+static inline int buffer_index(const struct IOContext *ioc, const void *buffer)
+{
+    const struct BufferArena *arena = &ioc->buffers;
+    const uint8_t *address = (const uint8_t *)buffer;
+    if (unlikely(!arena->memory || address < arena->memory ||
+                 address >= arena->memory +
+                                (size_t)arena->count * arena->slice_size))
+        return -1;
+
+    return (int)((size_t)(address - arena->memory) / arena->slice_size);
+}
 
 /**
- * Initiate a write request using io_uring for the specified file descriptor.
- *
- * This function prepares a write request using io_uring for the specified file descriptor,
- * associating it with a token and callback function. The token is acquired using the get_token
- * function. If the token cannot be obtained, the function returns -1. The function sets up
- * the necessary io_uring_sqe for the write operation and assigns the provided callback function,
- * file descriptor, buffer, size, and data to the token.
+ * Give back a slice retrieved with acquire_buffer.
  *
  * @param ioc
- *   A pointer to the IOContext structure representing the io_uring context.
- * @param fd
- *   The file descriptor to which data will be written.
+ *   A pointer to the IOContext structure.
  * @param buffer
- *   A pointer to the buffer containing the data to be written.
- * @param size
- *   The size of the data to be written.
- * @param cb
- *   A callback function to be executed when the write operation completes.
- * @param data
- *   A pointer to user data to be passed to the callback function.
+ *   A pointer returned by acquire_buffer.
+ */
+static inline void release_buffer(struct IOContext *ioc, void *buffer)
+{
+    struct BufferArena *arena = &ioc->buffers;
+    int index = buffer_index(ioc, buffer);
+    if (unlikely(index < 0 || arena->tail >= arena->count)) {
+        LOG_DEBUG("invalid buffer release. tail: %u, count: %u\n", arena->tail,
+                  arena->count);
+        return;
+    }
+
+    arena->free_slices[arena->tail++] = (uint32_t)index;
+}
+
+/**
+ * Retrieve the provided buffer a completion picked.
+ *
+ * @param flags
+ *   The flags of the completion, e.g. the `flags` of a Waiter.
  * @return
- *   0 on success, -1 on failure. Returns -1 if a token cannot be obtained or if
- *   there is an issue with io_uring_sqe setup.
+ *   The id of the buffer, or -1 if the completion did not pick any.
  */
-int request_write(struct IOContext *ioc, int fd, void *buffer, size_t size,
-                  write_cb cb, void *data);
+static inline int completion_buffer(uint32_t flags)
+{
+    if (!(flags & IORING_CQE_F_BUFFER))
+        return -1;
+
+    return (int)(flags >> IORING_CQE_BUFFER_SHIFT);
+}
 
 /**
- * Process completion queue entries for the given IOContext.
+ * Retrieve the memory of a provided buffer.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param id
+ *   The id of the buffer, as reported by completion_buffer.
+ * @return
+ *   A pointer to the `provided.buffer_size` bytes of the buffer.
+ */
+static inline void *provided_buffer(const struct IOContext *ioc, uint16_t id)
+{
+    return ioc->provided.memory + (size_t)id * ioc->provided.buffer_size;
+}
+
+/**
+ * Encode a token as the user_data of an sqe.
  *
- * This function submits a batch of io-uring operations, processes completion
- * queue entries, and invokes corresponding callback functions based on the type
- * of associated tokens. It releases resources associated with the processed
- * tokens to prevent memory leaks.
+ * The lower 32 bits hold the index of the token in the slab and the upper 32
+ * bits its generation. Generations start at 1, so user_data is never 0.
  *
  * @param ioc
- *   A pointer to the IOContext structure representing the io-uring instance.
- * @param batch
- *   The size of the batch of operations to be processed, limited to MAX_BATCH_SIZE.
+ *   A pointer to the IOContext structure owning the token.
+ * @param token
+ *   A pointer to the token to be encoded.
  * @return
- *   The number of processed entries on success, or an error code on failure.
+ *   The user_data identifying the current use of the token.
  */
-int process(struct IOContext *ioc, size_t batch);
+static inline uint64_t token_user_data(const struct IOContext *ioc,
+                                       const struct Token *token)
+{
+    return (uint64_t)token->generation << 32 |
+           (uint32_t)(token - ioc->tokens);
+}
+
+/**
+ * Decode the user_data of a cqe into its token.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure owning the token.
+ * @param user_data
+ *   The user_data produced by token_user_data.
+ * @return
+ *   A pointer to the token, or NULL if user_data does not identify the current
+ *   use of a token (e.g., 0 or a token that was released since).
+ */
+static inline struct Token *token_from_user_data(const struct IOContext *ioc,
+                                                 uint64_t user_data)
+{
+    uint32_t index = (uint32_t)user_data;
+    if (unlikely(index >= ioc->capacity))
+        return NULL;
+
+    struct Token *token = &ioc->tokens[index];
+    if (unlikely(token->generation != (uint32_t)(user_data >> 32)))
+        return NULL;
+
+    return token;
+}
+
+/**
+ * Append a waiter to the IOContext's ready queue.
+ *
+ * This static inline function marks the waiter as ready and links it at the
+ * tail of the intrusive FIFO ready queue. A waiter that is already marked as
+ * ready is not queued twice.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure owning the ready queue.
+ * @param waiter
+ *   A pointer to the waiter to be queued.
+ */
+static inline void push_ready_waiter(struct IOContext *ioc,
+                                     struct Waiter *waiter)
+{
+    if (unlikely(waiter->is_ready))
+        return;
+
+    waiter->is_ready = 1;
+    waiter->next = NULL;
+    if (ioc->ready_tail)
+        ioc->ready_tail->next = waiter;
+    else
+        ioc->ready_head = waiter;
+    ioc->ready_tail = waiter;
+}
+
+/**
+ * Remove the first waiter from the IOContext's ready queue.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure owning the ready queue.
+ * @return
+ *   A pointer to the oldest ready waiter, or NULL if the queue is empty.
+ */
+static inline struct Waiter *pop_ready_waiter(struct IOContext *ioc)
+{
+    struct Waiter *waiter = ioc->ready_head;
+    if (waiter) {
+        ioc->ready_head = waiter->next;
+        if (!ioc->ready_head)
+            ioc->ready_tail = NULL;
+        waiter->next = NULL;
+    }
+
+    return waiter;
+}
+
+/**
+ * Park a waiter until a provided buffer is recycled.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure owning the queue.
+ * @param waiter
+ *   A pointer to the waiter whose receive found the buffer ring empty.
+ */
+static inline void push_buffer_waiter(struct IOContext *ioc,
+                                      struct Waiter *waiter)
+{
+    struct BufferRing *provided = &ioc->provided;
+    waiter->next = NULL;
+    if (provided->wait_tail)
+        provided->wait_tail->next = waiter;
+    else
+        provided->wait_head = waiter;
+    provided->wait_tail = waiter;
+}
+
+/**
+ * Give a provided buffer back to the kernel.
+ *
+ * The buffer is appended to the ring and becomes available to the next
+ * receive. The first task parked on an empty ring, if any, is made ready to
+ * retry its receive.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param id
+ *   The id of the buffer, as reported by completion_buffer.
+ */
+static inline void recycle_buffer(struct IOContext *ioc, uint16_t id)
+{
+    struct BufferRing *provided = &ioc->provided;
+    io_uring_buf_ring_add(provided->ring, provided_buffer(ioc, id),
+                          (unsigned)provided->buffer_size, id,
+                          io_uring_buf_ring_mask(provided->count), 0);
+    io_uring_buf_ring_advance(provided->ring, 1);
+    ++provided->available;
+
+    struct Waiter *waiter = provided->wait_head;
+    if (unlikely(waiter != NULL)) {
+        provided->wait_head = waiter->next;
+        if (!provided->wait_head)
+            provided->wait_tail = NULL;
+        push_ready_waiter(ioc, waiter);
+    }
+}
+
+/**
+ * Park a waiter until the submission queue has room again.
+ *
+ * This static inline function appends the waiter to the FIFO queue of waiters
+ * whose request failed with -EBUSY. The next call to process submits the
+ * pending entries and moves every parked waiter to the ready queue, so that
+ * its request can be retried.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure owning the queue.
+ * @param waiter
+ *   A pointer to the waiter to be parked.
+ */
+static inline void push_sq_waiter(struct IOContext *ioc, struct Waiter *waiter)
+{
+    waiter->next = NULL;
+    if (ioc->sq_wait_tail)
+        ioc->sq_wait_tail->next = waiter;
+    else
+        ioc->sq_wait_head = waiter;
+    ioc->sq_wait_tail = waiter;
+}
+
+/**
+ * Initiate a wait request using io_uring for the specified duration.
+ *
+ * This function prepares a wait request using io_uring for the specified duration,
+ * associating it with a token and callback function. The token is acquired using
+ * the get_token function. If the token cannot be obtained, the function returns -ENOBUFS.
+ * When the submission queue is full, it is submitted to the kernel on demand.
+ * The function sets up the necessary io_uring_sqe for the wait operation and assigns
+ * the provided callback function and data to the token.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure representing the io_uring context.
+ * @param ts
+ *   A pointer to the __kernel_timespec structure specifying the duration to wait.
+ * @param cb
+ *   A callback function to be executed when the wait operation completes, or
+ *   NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_wait(struct IOContext *ioc, struct __kernel_timespec *ts,
+                 wait_cb cb, void *data);
+
+/**
+ * Make sure that process stops waiting at a deadline.
+ *
+ * The IOContext keeps a single absolute timeout in flight for the nearest
+ * deadline it was asked for, without holding a token: its completion only
+ * ends the wait of process. An earlier deadline moves the timeout, while a
+ * later one is left to be requested again once the timeout fired. Moving a
+ * timeout needs Linux 5.11.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param deadline_ns
+ *   The deadline on CLOCK_MONOTONIC, in nanoseconds.
+ * @return
+ *   0 on success, or -EBUSY if the submission queue is still full after
+ *   flushing it to the kernel.
+ */
+int request_wakeup(struct IOContext *ioc, uint64_t deadline_ns);
+
+/**
+ * Initiate an accept request using io_uring for the specified file descriptor.
+ *
+ * This function prepares an accept request using io_uring for the specified file descriptor,
+ * associating it with a token and callback function. The token is acquired using the get_token
+ * function. If the token cannot be obtained, the function returns -ENOBUFS. When the submission
+ * queue is full, it is submitted to the kernel on demand. The function sets up
+ * the necessary io_uring_sqe for the accept operation and assigns the provided callback function,
+ * file descriptor, and data to the token.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure representing the io_uring context.
+ * @param fd
+ *   The file descriptor for which the accept operation is initiated.
+ * @param cb
+ *   A callback function to be executed when the accept operation completes, or
+ *   NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_accept(struct IOContext *ioc, int fd, accept_cb cb, void *data);
+
+/**
+ * Initiate a read request using io_uring for the specified file descriptor.
+ *
+ * This function prepares a read request using io_uring for the specified file descriptor,
+ * associating it with a token and callback function. The token is acquired using the get_token
+ * function. If the token cannot be obtained, the function returns -ENOBUFS. When the submission
+ * queue is full, it is submitted to the kernel on demand. The function sets up
+ * the necessary io_uring_sqe for the read operation and assigns the provided callback function,
+ * file descriptor, buffer, size, and data to the token.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure representing the io_uring context.
+ * @param fd
+ *   The file descriptor from which to read.
+ * @param buffer
+ *   A pointer to the buffer where the read data will be stored.
+ * @param size
+ *   The size of the buffer.
+ * @param cb
+ *   A callback function to be executed when the read operation completes, or
+ *   NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_read(struct IOContext *ioc, int fd, void *buffer, size_t size,
+                 read_cb cb, void *data);
+
+/**
+ * Initiate a write request using io_uring for the specified file descriptor.
+ *
+ * This function prepares a write request using io_uring for the specified file descriptor,
+ * associating it with a token and callback function. The token is acquired using the get_token
+ * function. If the token cannot be obtained, the function returns -ENOBUFS. When the submission
+ * queue is full, it is submitted to the kernel on demand. The function sets up
+ * the necessary io_uring_sqe for the write operation and assigns the provided callback function,
+ * file descriptor, buffer, size, and data to the token.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure representing the io_uring context.
+ * @param fd
+ *   The file descriptor to which data will be written.
+ * @param buffer
+ *   A pointer to the buffer containing the data to be written.
+ * @param size
+ *   The size of the data to be written.
+ * @param cb
+ *   A callback function to be executed when the write operation completes, or
+ *   NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_write(struct IOContext *ioc, int fd, void *buffer, size_t size,
+                  write_cb cb, void *data);
+
+/**
+ * Initiate a read scattered into several buffers.
+ *
+ * The buffers are filled in order, so a single request can e.g. receive a
+ * fixed size header and the body following it into separate buffers. The
+ * array of buffers must stay valid until the request completes.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The file descriptor to read from.
+ * @param iov
+ *   The array of buffers to read into.
+ * @param count
+ *   The number of buffers in the array, at most IOV_MAX.
+ * @param cb
+ *   A callback function to be executed with the total number of bytes read,
+ *   or NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_readv(struct IOContext *ioc, int fd, const struct iovec *iov,
+                  unsigned count, read_cb cb, void *data);
+
+/**
+ * Initiate a write gathered from several buffers.
+ *
+ * A header and a body living in separate buffers are written with a single
+ * request, without copying them into one buffer first. The array of buffers
+ * must stay valid until the request completes.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The file descriptor to write to.
+ * @param iov
+ *   The array of buffers to write from.
+ * @param count
+ *   The number of buffers in the array, at most IOV_MAX.
+ * @param cb
+ *   A callback function to be executed with the total number of bytes
+ *   written, or NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_writev(struct IOContext *ioc, int fd, const struct iovec *iov,
+                   unsigned count, write_cb cb, void *data);
+
+/**
+ * Initiate a send of a message on a socket.
+ *
+ * Besides its buffers, the message header can carry a destination address
+ * and control data. With MSG_WAITALL the kernel retries partial sends on a
+ * stream socket until the whole message is sent, and MSG_NOSIGNAL turns the
+ * SIGPIPE of a closed peer into -EPIPE. The message header and the arrays it
+ * points to must stay valid until the request completes.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The socket to send to.
+ * @param msg
+ *   The message header describing the data to send.
+ * @param flags
+ *   MSG_* flags of the send, as for sendmsg.
+ * @param cb
+ *   A callback function to be executed with the number of bytes sent, or
+ *   NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_sendmsg(struct IOContext *ioc, int fd, const struct msghdr *msg,
+                    int flags, write_cb cb, void *data);
+
+/**
+ * Initiate a receive of a message on a socket.
+ *
+ * The kernel fills the buffers of the message header, and its address,
+ * control data and flags when the header provides room for them. With
+ * MSG_WAITALL the request completes only once every buffer is full, or
+ * when the peer closed the connection. The message header and the arrays it
+ * points to must stay valid until the request completes.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The socket to receive from.
+ * @param msg
+ *   The message header receiving the data.
+ * @param flags
+ *   MSG_* flags of the receive, as for recvmsg.
+ * @param cb
+ *   A callback function to be executed with the number of bytes received,
+ *   or NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_recvmsg(struct IOContext *ioc, int fd, struct msghdr *msg,
+                    int flags, read_cb cb, void *data);
+
+/**
+ * Initiate the creation of a socket.
+ *
+ * The request needs Linux 5.19. The new descriptor is a regular one, which
+ * can be used by any request or system call.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param domain
+ *   The communication domain, e.g. AF_INET.
+ * @param type
+ *   The socket type, e.g. SOCK_STREAM, optionally with SOCK_CLOEXEC.
+ * @param protocol
+ *   The protocol, usually 0.
+ * @param cb
+ *   A callback function to be executed with the new descriptor or an error
+ *   code, or NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_socket(struct IOContext *ioc, int domain, int type, int protocol,
+                   status_cb cb, void *data);
+
+/**
+ * Initiate the connection of a socket to an address.
+ *
+ * The address must stay valid until the request completes. A stream socket
+ * completes once the handshake is done, without blocking the thread that
+ * submitted the request.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The socket to connect.
+ * @param addr
+ *   The address to connect to.
+ * @param addrlen
+ *   The size of the address.
+ * @param cb
+ *   A callback function to be executed with 0 or an error code, or NULL to
+ *   resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_connect(struct IOContext *ioc, int fd, const struct sockaddr *addr,
+                    socklen_t addrlen, status_cb cb, void *data);
+
+/**
+ * Initiate the shutdown of a connection.
+ *
+ * Pending and armed receives of the socket complete once the receiving
+ * direction is shut down, which lets a task end multishot requests before
+ * closing the socket.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The socket to shut down.
+ * @param how
+ *   SHUT_RD, SHUT_WR or SHUT_RDWR.
+ * @param cb
+ *   A callback function to be executed with 0 or an error code, or NULL to
+ *   resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_shutdown(struct IOContext *ioc, int fd, int how, status_cb cb,
+                     void *data);
+
+/**
+ * Initiate the closing of a file descriptor.
+ *
+ * The last close of a socket may have to flush or linger, which the kernel
+ * does without blocking the thread that submitted the request. The
+ * descriptor must not be used by another request once this one is
+ * submitted.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The file descriptor to close.
+ * @param cb
+ *   A callback function to be executed with 0 or an error code, or NULL to
+ *   resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_close(struct IOContext *ioc, int fd, status_cb cb, void *data);
+
+/**
+ * Initiate a read request that fails with -ETIME past a deadline.
+ *
+ * This function works like request_read, and links an IORING_OP_LINK_TIMEOUT
+ * to the read: once the deadline passes, the kernel cancels the read itself,
+ * without a wake up of the event loop. Both requests are submitted together,
+ * and the completion of the timeout, which holds no token, is dropped by
+ * process.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure representing the io_uring context.
+ * @param fd
+ *   The file descriptor from which to read.
+ * @param buffer
+ *   A pointer to the buffer where the read data will be stored.
+ * @param size
+ *   The size of the buffer.
+ * @param deadline
+ *   The deadline on CLOCK_MONOTONIC. It is read when the requests are
+ *   submitted, so it must stay valid until then.
+ * @param cb
+ *   A callback function to be executed when the read operation completes, or
+ *   NULL to resume the Waiter pointed to by data directly. The result is
+ *   -ETIME if the deadline passed first.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue has no room for both requests after flushing it.
+ */
+int request_read_until(struct IOContext *ioc, int fd, void *buffer,
+                       size_t size, struct __kernel_timespec *deadline,
+                       read_cb cb, void *data);
+
+/**
+ * Initiate a write request that fails with -ETIME past a deadline.
+ *
+ * This function works like request_write, with a linked timeout as for
+ * request_read_until.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure representing the io_uring context.
+ * @param fd
+ *   The file descriptor to which to write.
+ * @param buffer
+ *   A pointer to the buffer containing the data to be written.
+ * @param size
+ *   The size of the data to be written.
+ * @param deadline
+ *   The deadline on CLOCK_MONOTONIC, valid until the requests are submitted.
+ * @param cb
+ *   A callback function to be executed when the write operation completes,
+ *   or NULL to resume the Waiter pointed to by data directly. The result is
+ *   -ETIME if the deadline passed first.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue has no room for both requests after flushing it.
+ */
+int request_write_until(struct IOContext *ioc, int fd, void *buffer,
+                        size_t size, struct __kernel_timespec *deadline,
+                        write_cb cb, void *data);
+
+/**
+ * Initiate an accept request that fails with -ETIME past a deadline.
+ *
+ * This function works like request_accept, with a linked timeout as for
+ * request_read_until.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure representing the io_uring context.
+ * @param fd
+ *   The listening socket.
+ * @param deadline
+ *   The deadline on CLOCK_MONOTONIC, valid until the requests are submitted.
+ * @param cb
+ *   A callback function to be executed when the accept operation completes,
+ *   or NULL to resume the Waiter pointed to by data directly. The result is
+ *   -ETIME if the deadline passed first.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue has no room for both requests after flushing it.
+ */
+int request_accept_until(struct IOContext *ioc, int fd,
+                         struct __kernel_timespec *deadline, accept_cb cb,
+                         void *data);
+
+/**
+ * Initiate the cancellation of a request in flight.
+ *
+ * This function submits an IORING_OP_ASYNC_CANCEL for the request identified
+ * by user_data, e.g. the one a Waiter is suspended on. The cancelled request
+ * completes with -ECANCELED, even if a deadline is linked to it. Since the
+ * user_data carries the generation of the token, a request that completed
+ * and whose token was reused is never cancelled by mistake.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure representing the io_uring context.
+ * @param user_data
+ *   The user_data of the request to cancel.
+ * @param cb
+ *   A callback function to be executed with the result of the cancellation,
+ *   or NULL to resume the Waiter pointed to by data directly. The result is
+ *   0 if the request was cancelled, -ENOENT if it was not found, or -EALREADY
+ *   if it is already running and may still complete.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOENT if user_data does not identify a request in flight,
+ *   -ENOBUFS if no token is available, or -EBUSY if the submission queue is
+ *   still full after flushing it to the kernel.
+ */
+int request_cancel(struct IOContext *ioc, uint64_t user_data, status_cb cb,
+                   void *data);
+
+/**
+ * Register a sparse table of direct descriptors with the ring.
+ *
+ * Requests on a direct descriptor name a slot of this table instead of a file
+ * descriptor, which saves the kernel the lookup and reference counting of the
+ * file on every operation. The IOContext allocates the first `slots -
+ * kernel_slots` slots; the last `kernel_slots` are left to the kernel, which
+ * installs the connections of multishot accept requests there.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param slots
+ *   The number of slots of the table.
+ * @param kernel_slots
+ *   The number of slots reserved to multishot accept requests.
+ * @return
+ *   0 on success, or a negative error code on failure.
+ */
+int register_files(struct IOContext *ioc, uint32_t slots,
+                   uint32_t kernel_slots);
+
+/**
+ * Install a file descriptor in a free slot of the registered file table.
+ *
+ * The table holds its own reference to the file: the descriptor can be
+ * closed once it is installed.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The file descriptor to be installed.
+ * @return
+ *   The slot on success, or a negative error code on failure.
+ */
+int register_file(struct IOContext *ioc, int fd);
+
+/**
+ * Remove the file of a slot of the registered file table and release the slot.
+ *
+ * The file is closed once the last request using it completes.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param slot
+ *   The slot to be emptied.
+ * @return
+ *   0 on success, or a negative error code on failure.
+ */
+int unregister_file(struct IOContext *ioc, uint32_t slot);
+
+/**
+ * Initiate an accept request installing the connection in a slot of the
+ * registered file table.
+ *
+ * The slot is usually allocated with allocate_file_slot. The result passed on
+ * completion is 0 on success, in which case the slot holds the connection, or
+ * a negative error code, in which case the caller still owns the empty slot.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The listening file descriptor.
+ * @param slot
+ *   The slot receiving the connection.
+ * @param cb
+ *   A callback function to be executed when the accept operation completes, or
+ *   NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -EINVAL for a slot out of the table, -ENOBUFS if no token is
+ *   available, or -EBUSY if the submission queue is still full after flushing
+ *   it to the kernel.
+ */
+int request_accept_direct(struct IOContext *ioc, int fd, uint32_t slot,
+                          accept_cb cb, void *data);
+
+/**
+ * Initiate a multishot accept request installing every connection in a slot
+ * of the registered file table.
+ *
+ * A single request accepts connections until it fails or is cancelled. The
+ * kernel picks the slot of each connection among the `kernel_slots` of
+ * register_files. The callback is executed for every completion with the
+ * slot or a negative error code, and the flags of the completion: the
+ * request has ended once IORING_CQE_F_MORE is not set, which may happen on a
+ * completion that still carries a slot. Slots are emptied with
+ * unregister_file.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The listening file descriptor.
+ * @param cb
+ *   A callback function to be executed for every completion.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -EINVAL without callback or kernel slots, -ENOBUFS if no
+ *   token is available, or -EBUSY if the submission queue is still full after
+ *   flushing it to the kernel.
+ */
+int request_multishot_accept_direct(struct IOContext *ioc, int fd,
+                                    multishot_cb cb, void *data);
+
+/**
+ * Initiate a multishot accept request.
+ *
+ * A single request accepts connections until it fails or is cancelled. The
+ * callback is executed for every completion with the accepted descriptor or
+ * a negative error code, and the flags of the completion: the request has
+ * ended once IORING_CQE_F_MORE is not set. Multishot accept needs Linux 5.19.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The listening file descriptor.
+ * @param cb
+ *   A callback function to be executed for every completion.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -EINVAL without callback, -ENOBUFS if no token is available,
+ *   or -EBUSY if the submission queue is still full after flushing it to the
+ *   kernel.
+ */
+int request_multishot_accept(struct IOContext *ioc, int fd, multishot_cb cb,
+                             void *data);
+
+/**
+ * Initialize an acceptor of the connections of a listening socket.
+ *
+ * The multishot accept request is armed by the first task waiting for a
+ * connection with async_accept_next, or by arm_acceptor.
+ *
+ * @param acceptor
+ *   A pointer to the Acceptor structure to be initialized.
+ * @param ioc
+ *   A pointer to the IOContext structure the request is armed on.
+ * @param fd
+ *   The listening socket.
+ * @param capacity
+ *   The number of accepted descriptors the queue initially holds. A full
+ *   queue doubles its capacity, and closes the connection if it cannot.
+ * @return
+ *   0 on success, -1 on failure.
+ */
+int init_acceptor(struct Acceptor *acceptor, struct IOContext *ioc, int fd,
+                  uint32_t capacity);
+
+/**
+ * Close the queued descriptors and free the queue of an acceptor.
+ *
+ * The request of an armed acceptor still references it: free the acceptor
+ * once its IOContext is freed, or once the request has ended.
+ *
+ * @param acceptor
+ *   A pointer to the Acceptor structure to be freed.
+ */
+void free_acceptor(struct Acceptor *acceptor);
+
+/**
+ * Submit the multishot accept request of an acceptor, unless it is armed.
+ *
+ * @param acceptor
+ *   A pointer to the Acceptor structure.
+ * @return
+ *   0 on success, or the error of request_multishot_accept.
+ */
+int arm_acceptor(struct Acceptor *acceptor);
+
+/**
+ * Park a waiter until the acceptor queues a connection or its request ends.
+ *
+ * @param acceptor
+ *   A pointer to the Acceptor structure owning the queue.
+ * @param waiter
+ *   A pointer to the waiter to be parked.
+ */
+static inline void push_acceptor_waiter(struct Acceptor *acceptor,
+                                        struct Waiter *waiter)
+{
+    waiter->next = NULL;
+    if (acceptor->wait_tail)
+        acceptor->wait_tail->next = waiter;
+    else
+        acceptor->wait_head = waiter;
+    acceptor->wait_tail = waiter;
+}
+
+/**
+ * Take the oldest connection queued by an acceptor.
+ *
+ * @param acceptor
+ *   A pointer to the Acceptor structure.
+ * @return
+ *   The accepted descriptor, or -EAGAIN if the queue is empty.
+ */
+static inline int pop_accepted(struct Acceptor *acceptor)
+{
+    if (unlikely(acceptor->count == 0))
+        return -EAGAIN;
+
+    int fd = acceptor->fds[acceptor->head];
+    acceptor->head = (acceptor->head + 1) % acceptor->capacity;
+    --acceptor->count;
+    return fd;
+}
+
+/**
+ * Initiate a read request on a slot of the registered file table.
+ *
+ * This function behaves like request_read, with the IOSQE_FIXED_FILE flag.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param slot
+ *   The slot of the file to read from.
+ * @param buffer
+ *   A pointer to the buffer where the read data will be stored.
+ * @param size
+ *   The size of the buffer, indicating the maximum number of bytes to read.
+ * @param cb
+ *   A callback function to be executed when the read operation completes, or
+ *   NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_read_direct(struct IOContext *ioc, uint32_t slot, void *buffer,
+                        size_t size, read_cb cb, void *data);
+
+/**
+ * Initiate a write request on a slot of the registered file table.
+ *
+ * This function behaves like request_write, with the IOSQE_FIXED_FILE flag.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param slot
+ *   The slot of the file to write to.
+ * @param buffer
+ *   A pointer to the buffer containing the data to be written.
+ * @param size
+ *   The size of the data to be written.
+ * @param cb
+ *   A callback function to be executed when the write operation completes, or
+ *   NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -ENOBUFS if no token is available, or -EBUSY if the
+ *   submission queue is still full after flushing it to the kernel.
+ */
+int request_write_direct(struct IOContext *ioc, uint32_t slot, void *buffer,
+                         size_t size, write_cb cb, void *data);
+
+/**
+ * Map an arena of buffers and register every slice of it with the ring.
+ *
+ * Slices are handed out with acquire_buffer and used by request_read_fixed
+ * and request_write_fixed. The registered pages stay pinned until the
+ * IOContext is freed and count towards RLIMIT_MEMLOCK.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param slice_size
+ *   The size of a slice in bytes, rounded up to a multiple of CACHE_LINE_SIZE.
+ * @param count
+ *   The number of slices, at most MAX_BUFFER_SLICES.
+ * @return
+ *   0 on success, or a negative error code on failure.
+ */
+int register_buffers(struct IOContext *ioc, size_t slice_size, uint32_t count);
+
+/**
+ * Initiate a read request into a slice of the registered buffer arena.
+ *
+ * This function behaves like request_read, but the kernel uses the pages
+ * pinned by register_buffers instead of pinning the buffer for the request.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The file descriptor to read from.
+ * @param buffer
+ *   A pointer inside a slice of the arena.
+ * @param size
+ *   The number of bytes to read, not crossing the end of the slice.
+ * @param cb
+ *   A callback function to be executed when the read operation completes, or
+ *   NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -EINVAL if the buffer is out of the arena, -ENOBUFS if no
+ *   token is available, or -EBUSY if the submission queue is still full after
+ *   flushing it to the kernel.
+ */
+int request_read_fixed(struct IOContext *ioc, int fd, void *buffer,
+                       size_t size, read_cb cb, void *data);
+
+/**
+ * Initiate a write request from a slice of the registered buffer arena.
+ *
+ * This function behaves like request_write, but the kernel uses the pages
+ * pinned by register_buffers instead of pinning the buffer for the request.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The file descriptor to write to.
+ * @param buffer
+ *   A pointer inside a slice of the arena.
+ * @param size
+ *   The number of bytes to write, not crossing the end of the slice.
+ * @param cb
+ *   A callback function to be executed when the write operation completes, or
+ *   NULL to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -EINVAL if the buffer is out of the arena, -ENOBUFS if no
+ *   token is available, or -EBUSY if the submission queue is still full after
+ *   flushing it to the kernel.
+ */
+int request_write_fixed(struct IOContext *ioc, int fd, void *buffer,
+                        size_t size, write_cb cb, void *data);
+
+/**
+ * Initiate a send whose pages the kernel transmits without copying them.
+ *
+ * The request completes twice. The first completion carries the number of
+ * bytes sent and is delivered to the callback, or resumes the waiter. The
+ * buffer must nevertheless stay untouched until the kernel notifies it no
+ * longer needs it, which calls the release function. When no notification
+ * follows, e.g. because the send failed, the release function is called
+ * along with the result. The whole buffer is sent unless the connection
+ * fails, and a closed peer yields -EPIPE rather than SIGPIPE. The
+ * notification reports whether the kernel copied the data anyway, see
+ * IOStats. Zero-copy sends with this report need Linux 6.2, and pay off for
+ * large buffers only: pinning the pages costs about as much as copying a
+ * few kilobytes.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The socket to send to.
+ * @param buffer
+ *   A pointer to the data to be sent.
+ * @param size
+ *   The size of the data to be sent.
+ * @param cb
+ *   A callback function to be executed with the result of the send, or NULL
+ *   to resume the Waiter pointed to by data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @param release
+ *   A function called once the buffer can be reused, or NULL.
+ * @param release_data
+ *   A pointer to user data to be passed to the release function.
+ * @return
+ *   0 on success, -ENOMEM if the release callbacks cannot be allocated,
+ *   -ENOBUFS if no token is available, or -EBUSY if the submission queue is
+ *   still full after flushing it to the kernel.
+ */
+int request_send_zc(struct IOContext *ioc, int fd, void *buffer, size_t size,
+                    write_cb cb, void *data, release_cb release,
+                    void *release_data);
+
+/**
+ * Map buffers and provide them to the kernel in a buffer ring.
+ *
+ * The ring is registered as the buffer group BUFFER_RING_GROUP of the ring of
+ * the IOContext, and used by request_recv_select. Provided buffer rings need
+ * Linux 5.19.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param buffer_size
+ *   The size of a buffer in bytes.
+ * @param count
+ *   The number of buffers, a power of two of at most MAX_RING_BUFFERS.
+ * @return
+ *   0 on success, or a negative error code on failure.
+ */
+int register_buffer_ring(struct IOContext *ioc, size_t buffer_size,
+                         uint32_t count);
+
+/**
+ * Initiate a receive into a buffer picked by the kernel when data arrives.
+ *
+ * The request does not hold any buffer while the socket is idle. On
+ * completion, the id of the picked buffer is in the flags of the completion,
+ * see completion_buffer, and the buffer belongs to the caller until it is
+ * given back with recycle_buffer. A receive completes with -ENOBUFS when the
+ * buffer ring is empty.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The socket to receive from.
+ * @param cb
+ *   A callback function to be executed when the receive completes, with the
+ *   id of the picked buffer or -1, or NULL to resume the Waiter pointed to by
+ *   data directly.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -EINVAL if no buffer ring is registered, -ENOBUFS if no
+ *   token is available, or -EBUSY if the submission queue is still full after
+ *   flushing it to the kernel.
+ */
+int request_recv_select(struct IOContext *ioc, int fd, recv_cb cb,
+                        void *data);
+
+/**
+ * Initiate a multishot receive into the buffers of the provided buffer ring.
+ *
+ * A single request receives data until the peer closes the connection, an
+ * error occurs or the buffer ring runs dry. The callback is executed for
+ * every completion with the received length, 0 once the peer closed the
+ * connection, or a negative error code, and the flags of the completion,
+ * which hold the id of the picked buffer, see completion_buffer. The request
+ * has ended once IORING_CQE_F_MORE is not set. Multishot receives need
+ * Linux 6.0.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure.
+ * @param fd
+ *   The socket to receive from.
+ * @param cb
+ *   A callback function to be executed for every completion.
+ * @param data
+ *   A pointer to user data to be passed to the callback function.
+ * @return
+ *   0 on success, -EINVAL without callback or buffer ring, -ENOBUFS if no
+ *   token is available, or -EBUSY if the submission queue is still full after
+ *   flushing it to the kernel.
+ */
+int request_recv_multishot(struct IOContext *ioc, int fd, multishot_cb cb,
+                           void *data);
+
+/**
+ * Initialize a stream of the data received on a socket.
+ *
+ * The multishot receive is armed by the first async_recv_next, or by
+ * arm_recv_stream.
+ *
+ * @param stream
+ *   A pointer to the RecvStream structure to be initialized.
+ * @param ioc
+ *   A pointer to the IOContext structure the request is armed on. A buffer
+ *   ring must be registered with register_buffer_ring.
+ * @param fd
+ *   The socket to receive from.
+ * @return
+ *   0 on success, -1 on failure.
+ */
+int init_recv_stream(struct RecvStream *stream, struct IOContext *ioc,
+                     int fd);
+
+/**
+ * Recycle the buffers of the queued chunks and free the queue of a stream.
+ *
+ * The request of an armed stream still references it: free the stream once
+ * the request has ended, e.g. after shutting the socket down for reading and
+ * draining the stream until async_recv_next returns 0.
+ *
+ * @param stream
+ *   A pointer to the RecvStream structure to be freed.
+ */
+void free_recv_stream(struct RecvStream *stream);
+
+/**
+ * Submit the multishot receive of a stream, unless it is armed.
+ *
+ * @param stream
+ *   A pointer to the RecvStream structure.
+ * @return
+ *   0 on success, or the error of request_recv_multishot.
+ */
+int arm_recv_stream(struct RecvStream *stream);
+
+/**
+ * Take the oldest chunk queued by a stream.
+ *
+ * @param stream
+ *   A pointer to the RecvStream structure.
+ * @param buffer_id
+ *   A pointer receiving the id of the provided buffer holding the chunk.
+ * @return
+ *   The length of the chunk, or -EAGAIN if the queue is empty.
+ */
+static inline ssize_t pop_received(struct RecvStream *stream,
+                                   uint16_t *buffer_id)
+{
+    if (unlikely(stream->count == 0))
+        return -EAGAIN;
+
+    struct Received *chunk = &stream->chunks[stream->head];
+    stream->head = (stream->head + 1) % stream->capacity;
+    --stream->count;
+    *buffer_id = chunk->buffer;
+    return chunk->length;
+}
+
+/**
+ * Process completion queue entries for the given IOContext.
+ *
+ * This function submits a batch of io-uring operations, wakes the waiters
+ * parked on a full submission queue, processes completion queue entries, and
+ * invokes corresponding callback functions based on the type of associated
+ * tokens. When no completion and no waiter is ready, it spins for a completion
+ * according to the spin policy of the IOContext, then submits and waits in a
+ * single system call according to its wait policy; otherwise it only enters the
+ * kernel to submit pending requests. Requests issued without a callback take a
+ * fast path: the result is stored in their Waiter, which is appended to the
+ * ready queue. The tokens of the processed entries are released at once after
+ * the batch, so callbacks issuing new requests are served from the remaining
+ * tokens. Multishot requests keep their token while their completions carry
+ * IORING_CQE_F_MORE. On an SQPOLL ring, submitting only enters the kernel when
+ * the polling thread went to sleep and flagged IORING_SQ_NEED_WAKEUP; these
+ * wakeups are counted in `stats.sq_wakeups`.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure representing the io-uring instance.
+ * @param batch
+ *   The size of the batch of operations to be processed, limited to MAX_BATCH_SIZE.
+ * @return
+ *   The number of processed entries on success, or an error code on failure.
+ *   0 is returned without blocking when parked waiters were woken and no
+ *   completion is available.
+ */
+int process(struct IOContext *ioc, size_t batch);
+
+/**
+ * Process the available completion queue entries without blocking.
+ *
+ * This function behaves like 'process', but only submits the pending
+ * requests instead of waiting when no completion is ready, e.g. when no
+ * timeout could be armed to bound the wait.
+ *
+ * @param ioc
+ *   A pointer to the IOContext structure representing the io-uring instance.
+ * @param batch
+ *   The size of the batch of operations to be processed, limited to MAX_BATCH_SIZE.
+ * @return
+ *   The number of processed entries on success, or an error code on failure.
+ */
+int process_nowait(struct IOContext *ioc, size_t batch);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,230 @@
+#ifndef STACK_H
+#define STACK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct Stack
+ * @brief Represents the stack memory of a coroutine in Cring.
+ *
+ * Stacks are anonymous private mappings, so the kernel commits their pages
+ * lazily on first touch and an idle coroutine only costs the pages it has
+ * actually used. The lowest page of every mapping is a PROT_NONE guard page:
+ * a stack overflow faults immediately instead of silently corrupting the
+ * neighbouring memory.
+ *
+ * - `void *memory`: Start of the mapping, i.e. the guard page.
+ * - `size_t size`: Usable size of the stack in bytes, guard page excluded.
+ */
+struct Stack {
+    void *memory;
+    size_t size;
+};
+
+#define STACK_CLASS_COUNT 16
+#define STACK_POOL_HIGH_WATER (64UL * 1024 * 1024)
+
+/**
+ * @struct StackClass
+ * @brief Represents the cached stacks of one size class of a StackPool.
+ *
+ * Stacks are kept in a LIFO array: the most recently released stack, whose
+ * pages are most likely still in the CPU caches, is handed out first. The
+ * bottom of the array holds the coldest stacks, which are the first to be
+ * given back to the kernel.
+ *
+ * - `struct Stack *stacks`: Dynamic array of cached stacks.
+ * - `size_t count`: Number of cached stacks.
+ * - `size_t capacity`: Number of stacks the array can hold.
+ * - `size_t cold`: Number of stacks at the bottom of the array whose pages
+ *    were already given back with MADV_DONTNEED.
+ */
+struct StackClass {
+    struct Stack *stacks;
+    size_t count;
+    size_t capacity;
+    size_t cold;
+};
+
+/**
+ * @struct StackPoolStats
+ * @brief Counters describing the activity of a StackPool.
+ *
+ * - `uint64_t hits`: Number of stacks served from the pool.
+ * - `uint64_t misses`: Number of stacks that had to be mapped.
+ * - `uint64_t trims`: Number of cached stacks given back to the kernel.
+ * - `size_t mapped_bytes`: Usable bytes of every live stack mapping.
+ * - `size_t cached_bytes`: Usable bytes of the stacks cached in the pool.
+ * - `size_t resident_bytes`: Upper bound of the committed stack memory: stacks
+ *    in use plus cached stacks that were not given back.
+ */
+struct StackPoolStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t trims;
+    size_t mapped_bytes;
+    size_t cached_bytes;
+    size_t resident_bytes;
+};
+
+/**
+ * @struct StackPool
+ * @brief Represents a per-executor allocator of coroutine stacks.
+ *
+ * Requests are rounded up to size classes of a power of two pages, from one
+ * page up to STACK_CLASS_COUNT - 1 doublings. Larger stacks bypass the pool.
+ * Once the cached stacks that may still be resident exceed the high-water
+ * mark, the coldest of them are given back with MADV_DONTNEED until half of
+ * the mark is left. Their mappings stay in the pool for later reuse.
+ *
+ * A stack that cannot be cached may still be running the task that releases
+ * it, so it is parked in `pending` and unmapped by the next call to the pool,
+ * once the task switched away from it.
+ *
+ * - `struct StackClass classes[STACK_CLASS_COUNT]`: Cached stacks per size class.
+ * - `size_t high_water`: Cached resident bytes that trigger giving memory back.
+ * - `size_t cached_resident`: Cached bytes that were not given back yet.
+ * - `struct StackPoolStats stats`: Counters of the pool activity.
+ * - `struct Stack pending`: Released stack waiting to be unmapped, or none.
+ */
+struct StackPool {
+    struct StackClass classes[STACK_CLASS_COUNT];
+    size_t high_water;
+    size_t cached_resident;
+    struct StackPoolStats stats;
+    struct Stack pending;
+};
+
+/**
+ * Retrieve the system page size.
+ *
+ * @return
+ *   The page size in bytes.
+ */
+size_t stack_page_size(void);
+
+/**
+ * Round a requested stack size to the size actually allocated.
+ *
+ * The size is rounded up to a whole number of pages, with a minimum of one
+ * page.
+ *
+ * @param size
+ *   The requested stack size in bytes.
+ * @return
+ *   The usable size of a stack allocated for the request.
+ */
+size_t stack_round_size(size_t size);
+
+/**
+ * Map a new stack with a guard page below it.
+ *
+ * @param stack
+ *   A pointer to the Stack structure to be initialized.
+ * @param size
+ *   The requested usable size in bytes, rounded with stack_round_size.
+ * @return
+ *   0 on success, -1 on failure.
+ */
+int allocate_stack(struct Stack *stack, size_t size);
+
+/**
+ * Unmap a stack previously mapped with allocate_stack.
+ *
+ * @param stack
+ *   A pointer to the Stack structure to be released. It is reset to zero.
+ */
+void free_stack(struct Stack *stack);
+
+/**
+ * Retrieve the lowest usable address of a stack.
+ *
+ * @param stack
+ *   A pointer to the Stack structure.
+ * @return
+ *   A pointer to the first byte above the guard page.
+ */
+static inline void *stack_bottom(const struct Stack *stack)
+{
+    return (uint8_t *)stack->memory + stack_page_size();
+}
+
+/**
+ * Initialize an empty stack pool.
+ *
+ * @param pool
+ *   A pointer to the StackPool structure to be initialized.
+ * @param high_water
+ *   Cached bytes above which idle stacks are given back to the kernel.
+ * @return
+ *   0 on success, -1 on failure.
+ */
+int init_stack_pool(struct StackPool *pool, size_t high_water);
+
+/**
+ * Unmap every stack cached in the pool and release its resources.
+ *
+ * Stacks currently handed out are not tracked by the pool and must be
+ * released by their owners before. The pending stack is unmapped as well.
+ *
+ * @param pool
+ *   A pointer to the StackPool structure to be freed.
+ */
+void free_stack_pool(struct StackPool *pool);
+
+/**
+ * Retrieve a stack of at least the given size from the pool.
+ *
+ * The most recently released stack of the matching size class is returned
+ * when available, otherwise a new stack is mapped. The pending stack, if
+ * any, is unmapped first.
+ *
+ * @param pool
+ *   A pointer to the StackPool structure.
+ * @param stack
+ *   A pointer to the Stack structure receiving the stack.
+ * @param size
+ *   The requested usable size in bytes.
+ * @return
+ *   0 on success, -1 on failure.
+ */
+int acquire_stack(struct StackPool *pool, struct Stack *stack, size_t size);
+
+/**
+ * Return a stack to the pool.
+ *
+ * The stack becomes the first candidate of its size class for reuse, and the
+ * most recently released stack of a class is never given back to the kernel.
+ * A stack larger than the size classes, or one the pool has no room for, is
+ * not unmapped right away but parked as the pending stack, which replaces
+ * and unmaps the previous one. It is thus safe to release the stack the
+ * caller is running on, as long as the caller switches away from it before
+ * it calls the pool again.
+ *
+ * @param pool
+ *   A pointer to the StackPool structure.
+ * @param stack
+ *   A pointer to the Stack structure to be released. It is reset to zero.
+ */
+void release_stack(struct StackPool *pool, struct Stack *stack);
+
+/**
+ * Unmap the pending stack of the pool, if any.
+ *
+ * The caller must not be running on the pending stack.
+ *
+ * @param pool
+ *   A pointer to the StackPool structure.
+ */
+void free_pending_stack(struct StackPool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TIMER_TICK_NS 1000000ULL
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1U << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 6
+#define NO_TIMER_DEADLINE UINT64_MAX
+
+typedef void (*timer_cb)(void * /*data*/);
+
+/**
+ * @struct Timer
+ * @brief Represents a callback armed for a deadline on a TimerWheel.
+ *
+ * Timers are intrusive: the owner embeds them, e.g. on the stack of a task
+ * or in a connection, and the wheel links them in its slots without
+ * allocating. A timer must be cancelled before its memory goes away.
+ *
+ * - `struct Timer *next`: Next timer in the same slot.
+ * - `struct Timer **prev`: Pointer to this timer in the slot list, NULL when
+ *    the timer is not armed.
+ * - `uint64_t expires`: Tick at which the timer fires.
+ * - `uint32_t slot`: Slot of the wheel the timer is linked in.
+ * - `timer_cb cb`: Function called when the timer fires.
+ * - `void *data`: A pointer to user data passed to the function.
+ */
+struct Timer {
+    struct Timer *next;
+    struct Timer **prev;
+    uint64_t expires;
+    uint32_t slot;
+    timer_cb cb;
+    void *data;
+};
+
+/**
+ * @struct TimerWheel
+ * @brief Represents a hierarchical timing wheel with O(1) arm and cancel.
+ *
+ * Time is cut in ticks of TIMER_TICK_NS. Each of the TIMER_WHEEL_LEVELS
+ * levels has TIMER_WHEEL_SLOTS slots, and a slot of level `l` spans
+ * TIMER_WHEEL_SLOTS^l ticks, so six levels of 64 slots cover more than two
+ * years of milliseconds. A timer is linked in the level its distance to the
+ * deadline falls in, and moves down a level each time the wheel reaches its
+ * slot, until it fires from the first level. Timers further away than the
+ * wheel spans wait in the last level and are placed again when it turns.
+ * A bitmap of the occupied slots of every level finds the next event
+ * without scanning empty slots.
+ *
+ * - `uint64_t now_ns`: Cached monotonic clock, updated by advance_timer_wheel.
+ * - `uint64_t tick`: Next tick to be processed.
+ * - `size_t count`: Number of armed timers.
+ * - `uint64_t occupied[TIMER_WHEEL_LEVELS]`: Non-empty slots of each level.
+ * - `struct Timer *slots[]`: Lists of the timers of every slot, level by level.
+ */
+struct TimerWheel {
+    uint64_t now_ns;
+    uint64_t tick;
+    size_t count;
+    uint64_t occupied[TIMER_WHEEL_LEVELS];
+    struct Timer *slots[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+};
+
+/**
+ * Initialize an empty timer wheel.
+ *
+ * @param wheel
+ *   A pointer to the TimerWheel structure to be initialized.
+ * @param now_ns
+ *   The current time of CLOCK_MONOTONIC, in nanoseconds.
+ */
+void init_timer_wheel(struct TimerWheel *wheel, uint64_t now_ns);
+
+/**
+ * Initialize a timer that is not armed.
+ *
+ * @param timer
+ *   A pointer to the Timer structure to be initialized.
+ * @param cb
+ *   The function called when the timer fires.
+ * @param data
+ *   A pointer to user data passed to the function.
+ */
+void init_timer(struct Timer *timer, timer_cb cb, void *data);
+
+/**
+ * Arm a timer for a deadline, or move it if it is already armed.
+ *
+ * The deadline is rounded up to the next tick, so a timer never fires
+ * early. A deadline in the past fires with the next advance of the wheel.
+ *
+ * @param wheel
+ *   A pointer to the TimerWheel structure.
+ * @param timer
+ *   A pointer to the initialized Timer structure.
+ * @param deadline_ns
+ *   The deadline on CLOCK_MONOTONIC, in nanoseconds.
+ */
+void arm_timer(struct TimerWheel *wheel, struct Timer *timer,
+               uint64_t deadline_ns);
+
+/**
+ * Cancel a timer.
+ *
+ * @param wheel
+ *   A pointer to the TimerWheel structure.
+ * @param timer
+ *   A pointer to the Timer structure.
+ * @return
+ *   1 if the timer was armed, 0 if it already fired or was never armed.
+ */
+int cancel_timer(struct TimerWheel *wheel, struct Timer *timer);
+
+/**
+ * Tell whether a timer is armed.
+ *
+ * @param timer
+ *   A pointer to the Timer structure.
+ * @return
+ *   1 if the timer is armed, 0 otherwise.
+ */
+static inline int timer_armed(const struct Timer *timer)
+{
+    return timer->prev != NULL;
+}
+
+/**
+ * Fire the timers whose deadline has passed.
+ *
+ * The callbacks run in the order of their deadlines, tick by tick. They may
+ * arm and cancel timers, themselves included: a timer armed for a deadline
+ * that has already passed fires with the next advance.
+ *
+ * @param wheel
+ *   A pointer to the TimerWheel structure.
+ * @param now_ns
+ *   The current time of CLOCK_MONOTONIC, in nanoseconds. It becomes the
+ *   cached clock of the wheel.
+ * @return
+ *   The number of timers fired.
+ */
+size_t advance_timer_wheel(struct TimerWheel *wheel, uint64_t now_ns);
+
+/**
+ * Retrieve the time at which the wheel has work to do next.
+ *
+ * This is the deadline of the nearest timer, rounded up to its tick, or the
+ * earlier time at which the timers of an upper level move down a level.
+ *
+ * @param wheel
+ *   A pointer to the TimerWheel structure.
+ * @return
+ *   The time on CLOCK_MONOTONIC in nanoseconds, or NO_TIMER_DEADLINE if no
+ *   timer is armed.
+ */
+uint64_t next_timer_deadline(const struct TimerWheel *wheel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,75 @@
+#include "Context.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef CRING_USE_UCONTEXT
+
+int make_context(struct Context *ctx, void *stack, size_t size,
+                 ContextEntry entry, void *data)
+{
+    if (!ctx || !stack || !size || !entry)
+        return -1;
+
+    if (getcontext(&ctx->uc) < 0)
+        return -1;
+
+    ctx->uc.uc_stack.ss_sp = stack;
+    ctx->uc.uc_stack.ss_size = size;
+    ctx->uc.uc_link = NULL;
+    makecontext(&ctx->uc, (void (*)(void))entry, 1, data);
+    return 0;
+}
+
+#else
+
+void cring_context_entry(void);
+
+#if defined(__x86_64__)
+/*
+ * Initial stack, from sp upwards:
+ * mxcsr/x87 cw, r15, r14, r13 (data), r12 (entry), rbx, rbp, return address.
+ */
+#define CONTEXT_FRAME_SIZE 80
+#define CONTEXT_ENTRY_SLOT 4
+#define CONTEXT_DATA_SLOT 3
+#define CONTEXT_RETURN_SLOT 7
+#elif defined(__aarch64__)
+/*
+ * Initial stack, from sp upwards:
+ * x19 (entry), x20 (data), x21-x28, x29, x30 (return address), d8-d15.
+ */
+#define CONTEXT_FRAME_SIZE 160
+#define CONTEXT_ENTRY_SLOT 0
+#define CONTEXT_DATA_SLOT 1
+#define CONTEXT_RETURN_SLOT 11
+#endif
+
+int make_context(struct Context *ctx, void *stack, size_t size,
+                 ContextEntry entry, void *data)
+{
+    if (!ctx || !stack || size < CONTEXT_FRAME_SIZE || !entry)
+        return -1;
+
+    uintptr_t top = ((uintptr_t)stack + size) & ~(uintptr_t)15;
+    uint64_t *sp = (uint64_t *)(top - CONTEXT_FRAME_SIZE);
+    memset(sp, 0, CONTEXT_FRAME_SIZE);
+
+#if defined(__x86_64__)
+    uint32_t mxcsr = 0;
+    uint16_t fpucw = 0;
+    __asm__ volatile("stmxcsr %0" : "=m"(mxcsr));
+    __asm__ volatile("fnstcw %0" : "=m"(fpucw));
+    memcpy((uint8_t *)sp, &mxcsr, sizeof(mxcsr));
+    memcpy((uint8_t *)sp + sizeof(mxcsr), &fpucw, sizeof(fpucw));
+#endif
+
+    sp[CONTEXT_ENTRY_SLOT] = (uint64_t)(uintptr_t)entry;
+    sp[CONTEXT_DATA_SLOT] = (uint64_t)(uintptr_t)data;
+    sp[CONTEXT_RETURN_SLOT] = (uint64_t)(uintptr_t)&cring_context_entry;
+
+    ctx->sp = sp;
+    return 0;
+}
+
+#endif
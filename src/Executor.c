@@ -5,53 +5,173 @@
 
 #include "IOContext.h"
 
-void read_fn(ssize_t length, void *data)
+void wait_for_token(struct Executor *executor)
 {
-    struct Frame *frame = (struct Frame *)data;
-    frame->result = length;
-    frame->is_ready = 1;
+    struct IOContext *ioc = &executor->ioc;
+    struct Frame *frame = get_current_frame(executor);
+
+    uint64_t start = now_ns();
+    push_token_waiter(ioc, &frame->waiter);
+    suspend_current_frame(executor);
+
+    // The token reserved by wake_token_waiters is taken by the retry.
+    --ioc->token_reserved;
+
+    uint64_t elapsed = now_ns() - start;
+    ++ioc->stats.token_waits;
+    ioc->stats.token_wait_ns += elapsed;
+    if (elapsed > ioc->stats.token_wait_max_ns)
+        ioc->stats.token_wait_max_ns = elapsed;
 }
 
-void write_fn(ssize_t length, void *data)
+void execute(void *data)
 {
-    struct Frame *frame = (struct Frame *)data;
-    frame->result = length;
-    frame->is_ready = 1;
+    struct Executor *executor = (struct Executor *)data;
+    struct Frame *frame = get_current_frame(executor);
+    frame->fn(executor, frame->data);
+    manage_async_finish(executor);
 }
 
-void wait_fn(void *data)
+static int allocate_frames(struct Executor *executor, size_t capacity)
 {
-    struct Frame *frame = (struct Frame *)data;
-    frame->is_ready = 1;
+    size_t count = capacity - executor->capacity;
+
+    struct Frame **chunks = (struct Frame **)realloc(
+        executor->chunks, (executor->chunk_count + 1) * sizeof(struct Frame *));
+    if (!chunks)
+        return -1;
+    executor->chunks = chunks;
+
+    struct Frame **frames = (struct Frame **)realloc(
+        executor->frames, capacity * sizeof(struct Frame *));
+    if (!frames)
+        return -1;
+    executor->frames = frames;
+
+    struct Frame *frame_mem = (struct Frame *)calloc(count, sizeof(struct Frame));
+    if (!frame_mem)
+        return -1;
+    executor->chunks[executor->chunk_count++] = frame_mem;
+
+    for (size_t i = 0; i < count; ++i) {
+        struct Frame *frame = &frame_mem[i];
+        frame->index = executor->capacity + i;
+        frame->executor = executor;
+        executor->frames[frame->index] = frame;
+    }
+
+    executor->capacity = capacity;
+    return 0;
 }
 
-void accept_fn(int fd, void *data)
+static int grow_frames(struct Executor *executor)
 {
-    struct Frame *frame = (struct Frame *)data;
-    frame->result = fd;
-    frame->is_ready = 1;
+    size_t limit = executor->frame_limit + 1;
+    if (unlikely(executor->capacity >= limit)) {
+        LOG_ERROR("Reach frame limit = %zu.\n", executor->frame_limit);
+        return -1;
+    }
+
+    size_t capacity = executor->capacity * 2;
+    if (capacity > limit)
+        capacity = limit;
+
+    if (unlikely(allocate_frames(executor, capacity) < 0)) {
+        LOG_ERROR("unable to grow frames to %zu\n", capacity);
+        return -1;
+    }
+
+    return 0;
 }
 
-void execute(Func fn, struct Executor *executor, void *data)
+int async_exec_with_stack(struct Executor *executor, Func fn, void *data,
+                          size_t stack_size)
 {
-    fn(executor, data);
-    manage_async_finish(executor);
+    if (unlikely(executor->size >= executor->capacity) &&
+        grow_frames(executor) < 0)
+        return -1;
+
+    struct Frame *frame = executor->frames[executor->size];
+    if (unlikely(acquire_stack(&executor->stacks, &frame->stack, stack_size) <
+                 0)) {
+        LOG_ERROR("unable to allocate frame stack\n");
+        return -1;
+    }
+
+    frame->fn = fn;
+    frame->data = data;
+    frame->waiter.user_data = NO_USER_DATA;
+    if (unlikely(make_context(&frame->exe, stack_bottom(&frame->stack),
+                              frame->stack.size, &execute, executor) < 0)) {
+        LOG_ERROR("unable to make frame context\n");
+        release_stack(&executor->stacks, &frame->stack);
+        return -1;
+    }
+
+    ++executor->size;
+    push_ready_frame(executor, frame);
+
+    return 0;
 }
 
 int async_exec(struct Executor *executor, Func fn, void *data)
 {
-    if (unlikely(executor->size >= executor->capacity)) {
-        LOG_ERROR("Reach frame capacity = %lu limit.\n", executor->capacity);
+    return async_exec_with_stack(executor, fn, data, STACK_SIZE);
+}
+
+int async_spawn(struct Executor *executor, Func fn, void *data,
+                struct TaskHandle *handle)
+{
+    if (async_exec(executor, fn, data) < 0)
         return -1;
-    }
 
-    struct Frame *frame = executor->frames[executor->size++];
-    makecontext(&frame->exe, (void (*)(void))execute, 3, fn, executor, data);
-    frame->is_ready = 1;
+    struct Frame *frame = get_last_frame(executor);
+    handle->frame = frame;
+    handle->generation = frame->generation;
+    return 0;
+}
+
+int async_group_spawn(struct Executor *executor, struct TaskGroup *group,
+                      Func fn, void *data, struct TaskHandle *handle)
+{
+    if (async_exec(executor, fn, data) < 0)
+        return -1;
+
+    struct Frame *frame = get_last_frame(executor);
+    frame->group = group;
+    ++group->running;
+    if (handle) {
+        handle->frame = frame;
+        handle->generation = frame->generation;
+    }
 
     return 0;
 }
 
+void notify_task_finished(struct Executor *executor, struct Frame *finished)
+{
+    struct Frame *joiner = finished->joiners;
+    finished->joiners = NULL;
+    while (joiner) {
+        struct Frame *next = joiner->next_joiner;
+        joiner->next_joiner = NULL;
+        push_ready_frame(executor, joiner);
+        joiner = next;
+    }
+
+    struct TaskGroup *group = finished->group;
+    if (!group)
+        return;
+
+    finished->group = NULL;
+    --group->running;
+    ++group->finished;
+    if (group->waiter && (!group->wait_all || !group->running)) {
+        push_ready_frame(executor, group->waiter);
+        group->waiter = NULL;
+    }
+}
+
 int free_executor(struct Executor *executor)
 {
     if (!executor) {
@@ -65,12 +185,14 @@ int free_executor(struct Executor *executor)
         return -1;
     }
 
-    if (executor->frames[0]->exe.uc_stack.ss_sp)
-        free(executor->frames[0]->exe.uc_stack.ss_sp);
+    for (size_t i = 0; i < executor->capacity; ++i)
+        release_stack(&executor->stacks, &executor->frames[i]->stack);
+    free_stack_pool(&executor->stacks);
 
-    if (executor->frames[0])
-        free(executor->frames[0]);
+    for (size_t i = 0; i < executor->chunk_count; ++i)
+        free(executor->chunks[i]);
 
+    free(executor->chunks);
     free(executor->frames);
     free_io_context(&executor->ioc);
 
@@ -79,6 +201,13 @@ int free_executor(struct Executor *executor)
 }
 
 int init_executor(struct Executor *executor, size_t count, size_t capacity)
+{
+    return init_executor_with_options(executor, count, capacity, NULL);
+}
+
+int init_executor_with_options(struct Executor *executor, size_t count,
+                               size_t capacity,
+                               const struct IOContextOptions *options)
 {
     if (!executor || !count) {
         LOG_ERROR("Invalid input parameters\n");
@@ -87,46 +216,42 @@ int init_executor(struct Executor *executor, size_t count, size_t capacity)
 
     memset(executor, 0, sizeof(*executor));
 
-    if (init_io_context(&executor->ioc, capacity) < 0) {
+    if (init_io_context_with_options(&executor->ioc, capacity, options) < 0) {
         LOG_ERROR("error in io context init\n");
         return -1;
     }
 
-    executor->capacity = align32pow2(count + 1);
+    executor->frame_limit = FRAME_LIMIT;
+    init_stack_pool(&executor->stacks, STACK_POOL_HIGH_WATER);
+    init_timer_wheel(&executor->timers, now_ns());
 
-    executor->frames =
-        (struct Frame **)calloc(executor->capacity, sizeof(struct Frame *));
-    uint8_t *stack_mem = (uint8_t *)calloc(executor->capacity, STACK_SIZE);
-    struct Frame *frame_mem =
-        (struct Frame *)calloc(executor->capacity, sizeof(struct Frame));
-    if (!stack_mem || !executor->frames || !frame_mem) {
+    if (allocate_frames(executor, align32pow2(count + 1)) < 0) {
         LOG_ERROR("unable to allocate memory\n");
-        if (stack_mem)
-            free(stack_mem);
-        if (frame_mem)
-            free(frame_mem);
+        free(executor->chunks);
+        free(executor->frames);
+        free_io_context(&executor->ioc);
+        memset(executor, 0, sizeof(*executor));
         return -1;
     }
 
-    struct Frame *frame = NULL;
-    for (size_t i = 0; i < executor->capacity; ++i) {
-        executor->frames[i] = &frame_mem[i];
-        frame = executor->frames[i];
-        frame->is_ready = 0;
-
-        getcontext(&frame->exe);
-        frame->exe.uc_stack.ss_sp = &stack_mem[i * STACK_SIZE];
-        frame->exe.uc_stack.ss_size = STACK_SIZE;
-        frame->exe.uc_link = &main_frame(executor)->exe;
-    }
-
     executor->size = 1;
     executor->current = 0;
-    executor->frames[0]->is_ready = 1;
+    executor->frames[0]->waiter.is_ready = 1;
 
     return 0;
 }
 
+int set_frame_limit(struct Executor *executor, size_t limit)
+{
+    if (!executor || !executor->frames || limit + 1 < executor->size) {
+        LOG_ERROR("Invalid frame limit\n");
+        return -1;
+    }
+
+    executor->frame_limit = limit;
+    return 0;
+}
+
 void run(struct Executor *executor)
 {
     if (!executor) {
@@ -143,16 +268,29 @@ void run(struct Executor *executor)
         next = move_to_next_ready_frame(executor);
 
         if (next != current) {
-            swapcontext(&current->exe, &next->exe);
+            switch_context(&current->exe, &next->exe);
         }
 
+        // The main frame never runs on a pool stack, so a stack released by
+        // a finished task can be unmapped here.
+        free_pending_stack(&executor->stacks);
+
         if (executor->size <= 1)
             break;
 
-        ret = process(&executor->ioc, BATCH_SIZE);
+        // A single timeout wakes the loop up for the nearest timer. Without
+        // room for it, the loop must not block: it polls and tries again.
+        uint64_t deadline = next_timer_deadline(&executor->timers);
+        if (deadline != NO_TIMER_DEADLINE &&
+            unlikely(request_wakeup(&executor->ioc, deadline) < 0))
+            ret = process_nowait(&executor->ioc, BATCH_SIZE);
+        else
+            ret = process(&executor->ioc, BATCH_SIZE);
         if (unlikely(ret < 0)) {
             LOG_ERROR("io context process returned %d.\n", ret);
             break;
         }
+
+        advance_timer_wheel(&executor->timers, now_ns());
     }
 }
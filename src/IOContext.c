@@ -1,25 +1,99 @@
 #include "IOContext.h"
 
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 int free_io_context(struct IOContext *ioc)
 {
     if (!ioc)
         return -1;
 
+    // The buffer ring is unregistered from the ring before it goes away.
+    if (ioc->provided.ring) {
+        io_uring_free_buf_ring(&ioc->ring, ioc->provided.ring,
+                               ioc->provided.count, BUFFER_RING_GROUP);
+        munmap(ioc->provided.memory,
+               (size_t)ioc->provided.count * ioc->provided.buffer_size);
+    }
     io_uring_queue_exit(&ioc->ring);
 
-    if (ioc->available_tokens[0])
-        free(ioc->available_tokens[0]);
-    if (ioc->available_tokens)
-        free(ioc->available_tokens);
+    free(ioc->tokens);
+    free(ioc->free_tokens);
+    free(ioc->free_files);
+    free(ioc->releases);
+    if (ioc->buffers.memory)
+        munmap(ioc->buffers.memory, (size_t)ioc->buffers.count *
+                                        ioc->buffers.slice_size);
+    free(ioc->buffers.free_slices);
 
     memset(ioc, 0, sizeof(struct IOContext));
     return 0;
 }
 
+static const uint32_t setup_fallbacks[] = {
+    IORING_SETUP_DEFER_TASKRUN,
+    IORING_SETUP_SINGLE_ISSUER,
+    IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG,
+    IORING_SETUP_SQPOLL | IORING_SETUP_SQ_AFF,
+};
+
+static int setup_ring(struct IOContext *ioc,
+                      const struct IOContextOptions *options)
+{
+    uint32_t flags = options ? options->flags : 0;
+    if (flags & IORING_SETUP_DEFER_TASKRUN)
+        flags |= IORING_SETUP_SINGLE_ISSUER;
+
+    size_t fallback = 0;
+    while (1) {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        params.flags = flags;
+        if (options && options->cq_entries) {
+            params.flags |= IORING_SETUP_CQSIZE;
+            params.cq_entries = options->cq_entries;
+        }
+        if (options && (flags & IORING_SETUP_SQPOLL)) {
+            params.sq_thread_idle = options->sq_thread_idle;
+            params.sq_thread_cpu = options->sq_thread_cpu;
+        }
+
+        int ret = io_uring_queue_init_params(ioc->capacity, &ioc->ring, &params);
+        if (ret == 0) {
+            ioc->setup_flags = params.flags;
+            return 0;
+        }
+
+        // Older kernels reject the flags they do not know with -EINVAL, and
+        // SQPOLL without CAP_SYS_NICE before 5.11 with -EPERM.
+        if (ret != -EINVAL &&
+            !(ret == -EPERM && (flags & IORING_SETUP_SQPOLL)))
+            return ret;
+
+        while (fallback < ARRAY_SIZE(setup_fallbacks) &&
+               !(flags & setup_fallbacks[fallback]))
+            ++fallback;
+        if (fallback == ARRAY_SIZE(setup_fallbacks))
+            return ret;
+
+        LOG_DEBUG("setup flags 0x%x rejected, retrying without 0x%x\n", flags,
+                  setup_fallbacks[fallback]);
+        flags &= ~setup_fallbacks[fallback++];
+    }
+}
+
 int init_io_context(struct IOContext *ioc, size_t capacity)
+{
+    return init_io_context_with_options(ioc, capacity, NULL);
+}
+
+int init_io_context_with_options(struct IOContext *ioc, size_t capacity,
+                                 const struct IOContextOptions *options)
 {
     if (!ioc || !capacity)
         return -1;
@@ -28,170 +102,1195 @@ int init_io_context(struct IOContext *ioc, size_t capacity)
     ioc->capacity = align32pow2(capacity + 1);
     ioc->tail = ioc->capacity;
 
-    ioc->available_tokens =
-        (struct Token **)calloc(ioc->capacity, sizeof(struct Token *));
-    struct Token *tokens =
-        (struct Token *)calloc(ioc->capacity, sizeof(struct Token));
+    size_t tokens_size = ioc->capacity * sizeof(struct Token);
+    tokens_size = (tokens_size + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+    ioc->tokens = (struct Token *)aligned_alloc(CACHE_LINE_SIZE, tokens_size);
+    ioc->free_tokens = (uint32_t *)calloc(ioc->capacity, sizeof(uint32_t));
 
-    if (!tokens || !ioc->available_tokens) {
-        if (tokens)
-            free(tokens);
-        if (ioc->available_tokens)
-            free(ioc->available_tokens);
+    if (!ioc->tokens || !ioc->free_tokens) {
+        free(ioc->tokens);
+        free(ioc->free_tokens);
+        memset(ioc, 0, sizeof(*ioc));
         return -1;
     }
 
-    for (uint32_t i = 0; i < ioc->capacity; ++i)
-        ioc->available_tokens[i] = &tokens[i];
+    memset(ioc->tokens, 0, tokens_size);
+    for (uint32_t i = 0; i < ioc->capacity; ++i) {
+        ioc->tokens[i].generation = 1;
+        ioc->free_tokens[i] = ioc->capacity - 1 - i;
+    }
 
-    struct io_uring_params params;
-    memset(&params, 0, sizeof(params));
+    uint32_t completions = options ? options->wait_completions : 0;
+    uint32_t timeout_us = options ? options->wait_timeout_us : 0;
+    if (set_wait_policy(ioc, completions ? completions : 1, timeout_us) < 0 ||
+        setup_ring(ioc, options) < 0) {
+        free(ioc->tokens);
+        free(ioc->free_tokens);
+        memset(ioc, 0, sizeof(*ioc));
+        return -1;
+    }
 
-    int ret = io_uring_queue_init_params(ioc->capacity, &ioc->ring, &params);
+    set_spin_policy(ioc, options ? options->spin_ns : 0);
+    return 0;
+}
 
-    if (ret < 0) {
-        free_io_context(ioc);
+int set_wait_policy(struct IOContext *ioc, uint32_t completions,
+                    uint32_t timeout_us)
+{
+    if (!ioc || completions == 0 || (completions > 1 && timeout_us == 0))
         return -1;
-    }
 
+    ioc->wait_completions = completions;
+    ioc->wait_timeout.tv_sec = timeout_us / 1000000;
+    ioc->wait_timeout.tv_nsec = (long long)(timeout_us % 1000000) * 1000;
     return 0;
 }
 
-int request_wait(struct IOContext *ioc, struct __kernel_timespec *ts,
-                 wait_cb cb, void *data)
+int set_spin_policy(struct IOContext *ioc, uint32_t max_ns)
 {
-    struct Token *token = get_token(ioc);
-    if (unlikely(token == NULL))
+    if (!ioc)
         return -1;
 
+    if (ioc->setup_flags & IORING_SETUP_DEFER_TASKRUN)
+        max_ns = 0;
+
+    // Start by spinning for the whole budget until waits are measured.
+    ioc->spin_max_ns = max_ns;
+    ioc->spin_budget_ns = max_ns;
+    ioc->wait_gap_ns = max_ns / 2;
+    return 0;
+}
+
+static inline struct io_uring_sqe *get_sqe(struct IOContext *ioc)
+{
     struct io_uring_sqe *sqe = io_uring_get_sqe(&ioc->ring);
-    if (unlikely(sqe == NULL)) {
-        release_token(ioc, token);
-        return -1;
+    if (likely(sqe != NULL))
+        return sqe;
+
+    // The submission queue is full: flush it to the kernel and retry.
+    ++ioc->stats.sq_flushes;
+    if (io_uring_submit(&ioc->ring) < 0)
+        return NULL;
+
+    // The SQPOLL thread consumes the queue on its own: wait until it has.
+    if (ioc->setup_flags & IORING_SETUP_SQPOLL)
+        io_uring_sqring_wait(&ioc->ring);
+
+    return io_uring_get_sqe(&ioc->ring);
+}
+
+// Make room for a request and the timeout linked to it, which must reach
+// the kernel in the same submission.
+static inline int reserve_sqes(struct IOContext *ioc, unsigned count)
+{
+    if (likely(io_uring_sq_space_left(&ioc->ring) >= count))
+        return 0;
+
+    ++ioc->stats.sq_flushes;
+    if (io_uring_submit(&ioc->ring) < 0)
+        return -EBUSY;
+
+    if (ioc->setup_flags & IORING_SETUP_SQPOLL)
+        io_uring_sqring_wait(&ioc->ring);
+
+    return io_uring_sq_space_left(&ioc->ring) >= count ? 0 : -EBUSY;
+}
+
+static inline int start_request(struct IOContext *ioc, struct Token **token,
+                                struct io_uring_sqe **sqe)
+{
+    *token = get_token(ioc);
+    if (unlikely(*token == NULL))
+        return -ENOBUFS;
+
+    *sqe = get_sqe(ioc);
+    if (unlikely(*sqe == NULL)) {
+        release_token(ioc, *token);
+        return -EBUSY;
     }
 
-    io_uring_prep_timeout(sqe, ts, 0, 0);
-    token->type = WAIT;
-    token->cb = (Cb)cb;
+    return 0;
+}
+
+static inline void finish_request(struct IOContext *ioc, struct Token *token,
+                                  struct io_uring_sqe *sqe,
+                                  enum RequestType type, int fd, Cb cb,
+                                  void *data)
+{
+    token->type = type;
+    token->fd = fd;
+    token->cb = cb;
     token->data = data;
-    io_uring_sqe_set_data(sqe, (void *)token);
+    token->flags = 0;
+
+    // Completions of the previous requests of the waiter are stale from now.
+    uint64_t user_data = token_user_data(ioc, token);
+    sqe->user_data = user_data;
+    if (!cb)
+        ((struct Waiter *)data)->user_data = user_data;
+}
 
+static inline int start_timed_request(struct IOContext *ioc,
+                                      struct Token **token,
+                                      struct io_uring_sqe **sqe,
+                                      struct __kernel_timespec *deadline)
+{
+    if (deadline) {
+        int ret = reserve_sqes(ioc, 2);
+        if (unlikely(ret < 0))
+            return ret;
+    }
+
+    return start_request(ioc, token, sqe);
+}
+
+// Called after finish_request, on the room made by start_timed_request.
+static inline void link_deadline(struct IOContext *ioc, struct Token *token,
+                                 struct io_uring_sqe *sqe,
+                                 struct __kernel_timespec *deadline)
+{
+    if (!deadline)
+        return;
+
+    sqe->flags |= IOSQE_IO_LINK;
+    token->flags |= TOKEN_DEADLINE;
+
+    struct io_uring_sqe *timeout = io_uring_get_sqe(&ioc->ring);
+    io_uring_prep_link_timeout(timeout, deadline, IORING_TIMEOUT_ABS);
+    timeout->user_data = LINK_TIMEOUT_USER_DATA;
+}
+
+int request_wait(struct IOContext *ioc, struct __kernel_timespec *ts,
+                 wait_cb cb, void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_timeout(sqe, ts, 0, 0);
+    finish_request(ioc, token, sqe, WAIT, -1, (Cb)cb, data);
+    return 0;
+}
+
+int request_wakeup(struct IOContext *ioc, uint64_t deadline_ns)
+{
+    if (ioc->wakeup_ns && ioc->wakeup_ns <= deadline_ns)
+        return 0;
+
+    struct io_uring_sqe *sqe = get_sqe(ioc);
+    if (unlikely(sqe == NULL))
+        return -EBUSY;
+
+    ioc->wakeup_ts.tv_sec = (int64_t)(deadline_ns / 1000000000ULL);
+    ioc->wakeup_ts.tv_nsec = (long long)(deadline_ns % 1000000000ULL);
+    if (ioc->wakeup_ns) {
+        io_uring_prep_timeout_update(sqe, &ioc->wakeup_ts, WAKEUP_USER_DATA,
+                                     IORING_TIMEOUT_ABS);
+        sqe->user_data = WAKEUP_UPDATE_USER_DATA;
+    } else {
+        io_uring_prep_timeout(sqe, &ioc->wakeup_ts, 0, IORING_TIMEOUT_ABS);
+        sqe->user_data = WAKEUP_USER_DATA;
+    }
+
+    ioc->wakeup_ns = deadline_ns;
+    return 0;
+}
+
+static int accept_request(struct IOContext *ioc, int fd, uint32_t slot,
+                          struct __kernel_timespec *deadline, accept_cb cb,
+                          void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_timed_request(ioc, &token, &sqe, deadline);
+    if (unlikely(ret < 0))
+        return ret;
+
+    if (slot == NO_FILE_SLOT)
+        io_uring_prep_accept(sqe, fd, NULL, NULL, 0);
+    else
+        io_uring_prep_accept_direct(sqe, fd, NULL, NULL, 0, slot);
+    finish_request(ioc, token, sqe, ACCEPT, fd, (Cb)cb, data);
+    link_deadline(ioc, token, sqe, deadline);
     return 0;
 }
 
 int request_accept(struct IOContext *ioc, int fd, accept_cb cb, void *data)
 {
-    struct Token *token = get_token(ioc);
-    if (unlikely(token == NULL))
+    return accept_request(ioc, fd, NO_FILE_SLOT, NULL, cb, data);
+}
+
+int request_accept_direct(struct IOContext *ioc, int fd, uint32_t slot,
+                          accept_cb cb, void *data)
+{
+    if (unlikely(slot >= ioc->file_slots))
+        return -EINVAL;
+
+    return accept_request(ioc, fd, slot, NULL, cb, data);
+}
+
+int request_multishot_accept_direct(struct IOContext *ioc, int fd,
+                                    multishot_cb cb, void *data)
+{
+    if (unlikely(cb == NULL || ioc->kernel_file_slots == 0))
+        return -EINVAL;
+
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_multishot_accept_direct(sqe, fd, NULL, NULL, 0);
+    finish_request(ioc, token, sqe, MULTISHOT, fd, (Cb)cb, data);
+    return 0;
+}
+
+int request_multishot_accept(struct IOContext *ioc, int fd, multishot_cb cb,
+                             void *data)
+{
+    if (unlikely(cb == NULL))
+        return -EINVAL;
+
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_multishot_accept(sqe, fd, NULL, NULL, 0);
+    finish_request(ioc, token, sqe, MULTISHOT, fd, (Cb)cb, data);
+    return 0;
+}
+
+int init_acceptor(struct Acceptor *acceptor, struct IOContext *ioc, int fd,
+                  uint32_t capacity)
+{
+    if (!acceptor || !ioc || fd < 0 || !capacity)
         return -1;
 
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&ioc->ring);
-    if (unlikely(sqe == NULL)) {
-        release_token(ioc, token);
+    memset(acceptor, 0, sizeof(*acceptor));
+    acceptor->fds = (int *)malloc(capacity * sizeof(int));
+    if (!acceptor->fds)
         return -1;
-    }
 
-    io_uring_prep_accept(sqe, fd, NULL, NULL, 0);
-    token->type = ACCEPT;
-    token->fd = fd;
-    token->cb = (Cb)cb;
-    token->data = data;
-    io_uring_sqe_set_data(sqe, (void *)token);
+    acceptor->ioc = ioc;
+    acceptor->fd = fd;
+    acceptor->capacity = capacity;
     return 0;
 }
 
-int request_read(struct IOContext *ioc, int fd, void *buffer, size_t size,
-                 read_cb cb, void *data)
+void free_acceptor(struct Acceptor *acceptor)
 {
-    struct Token *token = get_token(ioc);
-    if (unlikely(token == NULL))
-        return -1;
+    if (!acceptor || !acceptor->fds)
+        return;
 
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&ioc->ring);
-    if (unlikely(sqe == NULL)) {
-        release_token(ioc, token);
+    int fd;
+    while ((fd = pop_accepted(acceptor)) >= 0)
+        close(fd);
+    free(acceptor->fds);
+    memset(acceptor, 0, sizeof(*acceptor));
+}
+
+static int grow_acceptor(struct Acceptor *acceptor)
+{
+    uint32_t capacity = acceptor->capacity * 2;
+    int *fds = (int *)malloc(capacity * sizeof(int));
+    if (!fds)
         return -1;
+
+    for (uint32_t i = 0; i < acceptor->count; ++i)
+        fds[i] = acceptor->fds[(acceptor->head + i) % acceptor->capacity];
+
+    free(acceptor->fds);
+    acceptor->fds = fds;
+    acceptor->capacity = capacity;
+    acceptor->head = 0;
+    return 0;
+}
+
+static void acceptor_complete(int result, uint32_t flags, void *data)
+{
+    struct Acceptor *acceptor = (struct Acceptor *)data;
+
+    if (likely(result >= 0)) {
+        ++acceptor->accepted;
+        if (unlikely(acceptor->count == acceptor->capacity &&
+                     grow_acceptor(acceptor) < 0)) {
+            ++acceptor->dropped;
+            close(result);
+        } else {
+            uint32_t tail =
+                (acceptor->head + acceptor->count) % acceptor->capacity;
+            acceptor->fds[tail] = result;
+            ++acceptor->count;
+        }
+    } else {
+        acceptor->error = result;
+    }
+
+    // A connection wakes up a single task. Once the request has ended, all
+    // of them are woken up, so that one of them arms it again.
+    int ended = !(flags & IORING_CQE_F_MORE);
+    if (ended)
+        acceptor->armed = 0;
+    while (acceptor->wait_head) {
+        struct Waiter *waiter = acceptor->wait_head;
+        acceptor->wait_head = waiter->next;
+        if (!acceptor->wait_head)
+            acceptor->wait_tail = NULL;
+        push_ready_waiter(acceptor->ioc, waiter);
+        if (!ended)
+            break;
     }
+}
+
+int arm_acceptor(struct Acceptor *acceptor)
+{
+    if (acceptor->armed)
+        return 0;
+
+    int ret = request_multishot_accept(acceptor->ioc, acceptor->fd,
+                                       &acceptor_complete, acceptor);
+    if (unlikely(ret < 0))
+        return ret;
+
+    acceptor->armed = 1;
+    ++acceptor->arms;
+    return 0;
+}
+
+static int read_request(struct IOContext *ioc, int fd, uint8_t sqe_flags,
+                        void *buffer, size_t size,
+                        struct __kernel_timespec *deadline, read_cb cb,
+                        void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_timed_request(ioc, &token, &sqe, deadline);
+    if (unlikely(ret < 0))
+        return ret;
 
     io_uring_prep_read(sqe, fd, buffer, size, 0);
-    token->type = READ;
-    token->fd = fd;
-    token->cb = (Cb)cb;
-    token->data = data;
-    io_uring_sqe_set_data(sqe, (void *)token);
+    sqe->flags |= sqe_flags;
+    finish_request(ioc, token, sqe, READ, fd, (Cb)cb, data);
+    link_deadline(ioc, token, sqe, deadline);
+    return 0;
+}
+
+int request_read(struct IOContext *ioc, int fd, void *buffer, size_t size,
+                 read_cb cb, void *data)
+{
+    return read_request(ioc, fd, 0, buffer, size, NULL, cb, data);
+}
+
+int request_read_direct(struct IOContext *ioc, uint32_t slot, void *buffer,
+                        size_t size, read_cb cb, void *data)
+{
+    return read_request(ioc, (int)slot, IOSQE_FIXED_FILE, buffer, size, NULL,
+                        cb, data);
+}
+
+static int write_request(struct IOContext *ioc, int fd, uint8_t sqe_flags,
+                         void *buffer, size_t size,
+                         struct __kernel_timespec *deadline, write_cb cb,
+                         void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_timed_request(ioc, &token, &sqe, deadline);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_write(sqe, fd, buffer, size, 0);
+    sqe->flags |= sqe_flags;
+    finish_request(ioc, token, sqe, WRITE, fd, (Cb)cb, data);
+    link_deadline(ioc, token, sqe, deadline);
     return 0;
 }
 
 int request_write(struct IOContext *ioc, int fd, void *buffer, size_t size,
                   write_cb cb, void *data)
 {
-    struct Token *token = get_token(ioc);
-    if (unlikely(token == NULL))
+    return write_request(ioc, fd, 0, buffer, size, NULL, cb, data);
+}
+
+int request_write_direct(struct IOContext *ioc, uint32_t slot, void *buffer,
+                         size_t size, write_cb cb, void *data)
+{
+    return write_request(ioc, (int)slot, IOSQE_FIXED_FILE, buffer, size, NULL,
+                         cb, data);
+}
+
+int request_readv(struct IOContext *ioc, int fd, const struct iovec *iov,
+                  unsigned count, read_cb cb, void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_readv(sqe, fd, iov, count, 0);
+    finish_request(ioc, token, sqe, READV, fd, (Cb)cb, data);
+    return 0;
+}
+
+int request_writev(struct IOContext *ioc, int fd, const struct iovec *iov,
+                   unsigned count, write_cb cb, void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_writev(sqe, fd, iov, count, 0);
+    finish_request(ioc, token, sqe, WRITEV, fd, (Cb)cb, data);
+    return 0;
+}
+
+int request_sendmsg(struct IOContext *ioc, int fd, const struct msghdr *msg,
+                    int flags, write_cb cb, void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_sendmsg(sqe, fd, msg, (unsigned)flags);
+    finish_request(ioc, token, sqe, SENDMSG, fd, (Cb)cb, data);
+    return 0;
+}
+
+int request_recvmsg(struct IOContext *ioc, int fd, struct msghdr *msg,
+                    int flags, read_cb cb, void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_recvmsg(sqe, fd, msg, (unsigned)flags);
+    finish_request(ioc, token, sqe, RECVMSG, fd, (Cb)cb, data);
+    return 0;
+}
+
+int request_socket(struct IOContext *ioc, int domain, int type, int protocol,
+                   status_cb cb, void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_socket(sqe, domain, type, protocol, 0);
+    finish_request(ioc, token, sqe, SOCKET, -1, (Cb)cb, data);
+    return 0;
+}
+
+int request_connect(struct IOContext *ioc, int fd, const struct sockaddr *addr,
+                    socklen_t addrlen, status_cb cb, void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_connect(sqe, fd, addr, addrlen);
+    finish_request(ioc, token, sqe, CONNECT, fd, (Cb)cb, data);
+    return 0;
+}
+
+int request_shutdown(struct IOContext *ioc, int fd, int how, status_cb cb,
+                     void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_shutdown(sqe, fd, how);
+    finish_request(ioc, token, sqe, SHUTDOWN, fd, (Cb)cb, data);
+    return 0;
+}
+
+int request_close(struct IOContext *ioc, int fd, status_cb cb, void *data)
+{
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_close(sqe, fd);
+    finish_request(ioc, token, sqe, CLOSE, fd, (Cb)cb, data);
+    return 0;
+}
+
+int request_read_until(struct IOContext *ioc, int fd, void *buffer,
+                       size_t size, struct __kernel_timespec *deadline,
+                       read_cb cb, void *data)
+{
+    return read_request(ioc, fd, 0, buffer, size, deadline, cb, data);
+}
+
+int request_write_until(struct IOContext *ioc, int fd, void *buffer,
+                        size_t size, struct __kernel_timespec *deadline,
+                        write_cb cb, void *data)
+{
+    return write_request(ioc, fd, 0, buffer, size, deadline, cb, data);
+}
+
+int request_accept_until(struct IOContext *ioc, int fd,
+                         struct __kernel_timespec *deadline, accept_cb cb,
+                         void *data)
+{
+    return accept_request(ioc, fd, NO_FILE_SLOT, deadline, cb, data);
+}
+
+int request_cancel(struct IOContext *ioc, uint64_t user_data, status_cb cb,
+                   void *data)
+{
+    struct Token *target = token_from_user_data(ioc, user_data);
+    if (!target)
+        return -ENOENT;
+
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    // A cancelled request did not miss its deadline, even with a timeout.
+    target->flags &= ~TOKEN_DEADLINE;
+    io_uring_prep_cancel64(sqe, user_data, 0);
+    finish_request(ioc, token, sqe, CANCEL, -1, (Cb)cb, data);
+    return 0;
+}
+
+int register_files(struct IOContext *ioc, uint32_t slots,
+                   uint32_t kernel_slots)
+{
+    if (!ioc || !slots || kernel_slots > slots || ioc->file_slots)
+        return -EINVAL;
+
+    uint32_t tracked = slots - kernel_slots;
+    uint32_t *free_files = (uint32_t *)malloc(
+        (tracked ? tracked : 1) * sizeof(uint32_t));
+    if (!free_files)
+        return -ENOMEM;
+
+    // The kernel installs the files accepted by multishot requests in the
+    // slots at the end of the table, the others are allocated here.
+    int ret = io_uring_register_files_sparse(&ioc->ring, slots);
+    if (ret == 0 && kernel_slots) {
+        ret = io_uring_register_file_alloc_range(&ioc->ring, tracked,
+                                                 kernel_slots);
+        if (ret < 0)
+            io_uring_unregister_files(&ioc->ring);
+    }
+    if (ret < 0) {
+        free(free_files);
+        return ret;
+    }
+
+    for (uint32_t i = 0; i < tracked; ++i)
+        free_files[i] = tracked - 1 - i;
+
+    ioc->free_files = free_files;
+    ioc->file_tail = tracked;
+    ioc->file_slots = slots;
+    ioc->kernel_file_slots = kernel_slots;
+    return 0;
+}
+
+int register_file(struct IOContext *ioc, int fd)
+{
+    int slot = allocate_file_slot(ioc);
+    if (unlikely(slot < 0))
+        return slot;
+
+    int ret = io_uring_register_files_update(&ioc->ring, (unsigned)slot, &fd,
+                                             1);
+    if (unlikely(ret < 0)) {
+        release_file_slot(ioc, (uint32_t)slot);
+        return ret;
+    }
+
+    return slot;
+}
+
+int unregister_file(struct IOContext *ioc, uint32_t slot)
+{
+    if (unlikely(slot >= ioc->file_slots))
+        return -EINVAL;
+
+    int fd = -1;
+    int ret = io_uring_register_files_update(&ioc->ring, slot, &fd, 1);
+    if (unlikely(ret < 0))
+        return ret;
+
+    if (slot < ioc->file_slots - ioc->kernel_file_slots)
+        release_file_slot(ioc, slot);
+    return 0;
+}
+
+int register_buffers(struct IOContext *ioc, size_t slice_size, uint32_t count)
+{
+    if (!ioc || !slice_size || !count || count > MAX_BUFFER_SLICES ||
+        ioc->buffers.memory)
+        return -EINVAL;
+
+    slice_size = (slice_size + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+    size_t size = slice_size * count;
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return -ENOMEM;
+
+    uint32_t *free_slices = (uint32_t *)malloc(count * sizeof(uint32_t));
+    struct iovec *iovecs = (struct iovec *)malloc(count * sizeof(struct iovec));
+    if (!free_slices || !iovecs) {
+        free(free_slices);
+        free(iovecs);
+        munmap(memory, size);
+        return -ENOMEM;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        iovecs[i].iov_base = (uint8_t *)memory + (size_t)i * slice_size;
+        iovecs[i].iov_len = slice_size;
+        free_slices[i] = count - 1 - i;
+    }
+
+    int ret = io_uring_register_buffers(&ioc->ring, iovecs, count);
+    free(iovecs);
+    if (ret < 0) {
+        free(free_slices);
+        munmap(memory, size);
+        return ret;
+    }
+
+    ioc->buffers.memory = (uint8_t *)memory;
+    ioc->buffers.slice_size = slice_size;
+    ioc->buffers.count = count;
+    ioc->buffers.tail = count;
+    ioc->buffers.free_slices = free_slices;
+    return 0;
+}
+
+int request_read_fixed(struct IOContext *ioc, int fd, void *buffer,
+                       size_t size, read_cb cb, void *data)
+{
+    int index = buffer_index(ioc, buffer);
+    if (unlikely(index < 0))
+        return -EINVAL;
+
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_read_fixed(sqe, fd, buffer, size, 0, index);
+    finish_request(ioc, token, sqe, READ, fd, (Cb)cb, data);
+    return 0;
+}
+
+int request_write_fixed(struct IOContext *ioc, int fd, void *buffer,
+                        size_t size, write_cb cb, void *data)
+{
+    int index = buffer_index(ioc, buffer);
+    if (unlikely(index < 0))
+        return -EINVAL;
+
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_write_fixed(sqe, fd, buffer, size, 0, index);
+    finish_request(ioc, token, sqe, WRITE, fd, (Cb)cb, data);
+    return 0;
+}
+
+int request_send_zc(struct IOContext *ioc, int fd, void *buffer, size_t size,
+                    write_cb cb, void *data, release_cb release,
+                    void *release_data)
+{
+    if (unlikely(ioc->releases == NULL)) {
+        ioc->releases = calloc(ioc->capacity, sizeof(struct Release));
+        if (!ioc->releases)
+            return -ENOMEM;
+    }
+
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    // Ask the notification to tell whether the kernel had to copy anyway.
+    io_uring_prep_send_zc(sqe, fd, buffer, size, MSG_WAITALL | MSG_NOSIGNAL,
+                          IORING_SEND_ZC_REPORT_USAGE);
+    finish_request(ioc, token, sqe, SEND_ZC, fd, (Cb)cb, data);
+
+    struct Release *slot = &ioc->releases[token - ioc->tokens];
+    slot->cb = release;
+    slot->data = release_data;
+    return 0;
+}
+
+int register_buffer_ring(struct IOContext *ioc, size_t buffer_size,
+                         uint32_t count)
+{
+    if (!ioc || !buffer_size || buffer_size > UINT32_MAX || !count ||
+        count > MAX_RING_BUFFERS || (count & (count - 1)) ||
+        ioc->provided.ring)
+        return -EINVAL;
+
+    size_t size = buffer_size * count;
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return -ENOMEM;
+
+    int ret;
+    struct io_uring_buf_ring *ring = io_uring_setup_buf_ring(
+        &ioc->ring, count, BUFFER_RING_GROUP, 0, &ret);
+    if (!ring) {
+        munmap(memory, size);
+        return ret;
+    }
+
+    ioc->provided.ring = ring;
+    ioc->provided.memory = (uint8_t *)memory;
+    ioc->provided.buffer_size = buffer_size;
+    ioc->provided.count = count;
+    ioc->provided.available = count;
+
+    int mask = io_uring_buf_ring_mask(count);
+    for (uint32_t i = 0; i < count; ++i)
+        io_uring_buf_ring_add(ring, provided_buffer(ioc, (uint16_t)i),
+                              (unsigned)buffer_size, (unsigned short)i, mask,
+                              (int)i);
+    io_uring_buf_ring_advance(ring, (int)count);
+    return 0;
+}
+
+int request_recv_select(struct IOContext *ioc, int fd, recv_cb cb, void *data)
+{
+    if (unlikely(ioc->provided.ring == NULL))
+        return -EINVAL;
+
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_recv(sqe, fd, NULL, ioc->provided.buffer_size, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_RING_GROUP;
+    finish_request(ioc, token, sqe, RECV, fd, (Cb)cb, data);
+    return 0;
+}
+
+int request_recv_multishot(struct IOContext *ioc, int fd, multishot_cb cb,
+                           void *data)
+{
+    if (unlikely(cb == NULL || ioc->provided.ring == NULL))
+        return -EINVAL;
+
+    struct Token *token;
+    struct io_uring_sqe *sqe;
+    int ret = start_request(ioc, &token, &sqe);
+    if (unlikely(ret < 0))
+        return ret;
+
+    io_uring_prep_recv_multishot(sqe, fd, NULL, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_RING_GROUP;
+    finish_request(ioc, token, sqe, MULTISHOT, fd, (Cb)cb, data);
+    return 0;
+}
+
+#define RECV_STREAM_CAPACITY 4
+
+int init_recv_stream(struct RecvStream *stream, struct IOContext *ioc,
+                     int fd)
+{
+    if (!stream || !ioc || fd < 0 || !ioc->provided.ring)
         return -1;
 
-    struct io_uring_sqe *sqe = io_uring_get_sqe(&ioc->ring);
-    if (unlikely(sqe == NULL)) {
-        release_token(ioc, token);
+    memset(stream, 0, sizeof(*stream));
+    stream->chunks = (struct Received *)malloc(RECV_STREAM_CAPACITY *
+                                               sizeof(struct Received));
+    if (!stream->chunks)
+        return -1;
+
+    stream->ioc = ioc;
+    stream->fd = fd;
+    stream->capacity = RECV_STREAM_CAPACITY;
+    return 0;
+}
+
+void free_recv_stream(struct RecvStream *stream)
+{
+    if (!stream || !stream->chunks)
+        return;
+
+    uint16_t id;
+    while (pop_received(stream, &id) >= 0)
+        recycle_buffer(stream->ioc, id);
+    free(stream->chunks);
+    memset(stream, 0, sizeof(*stream));
+}
+
+static int grow_recv_stream(struct RecvStream *stream)
+{
+    uint32_t capacity = stream->capacity * 2;
+    struct Received *chunks =
+        (struct Received *)malloc(capacity * sizeof(struct Received));
+    if (!chunks)
         return -1;
+
+    for (uint32_t i = 0; i < stream->count; ++i)
+        chunks[i] = stream->chunks[(stream->head + i) % stream->capacity];
+
+    free(stream->chunks);
+    stream->chunks = chunks;
+    stream->capacity = capacity;
+    stream->head = 0;
+    return 0;
+}
+
+static void recv_stream_complete(int result, uint32_t flags, void *data)
+{
+    struct RecvStream *stream = (struct RecvStream *)data;
+    int buffer = completion_buffer(flags);
+
+    if (likely(result > 0 && buffer >= 0)) {
+        if (unlikely(stream->count == stream->capacity &&
+                     grow_recv_stream(stream) < 0)) {
+            recycle_buffer(stream->ioc, (uint16_t)buffer);
+            stream->error = -ENOMEM;
+        } else {
+            uint32_t tail = (stream->head + stream->count) % stream->capacity;
+            stream->chunks[tail].length = result;
+            stream->chunks[tail].buffer = (uint16_t)buffer;
+            ++stream->count;
+        }
+    } else {
+        if (buffer >= 0)
+            recycle_buffer(stream->ioc, (uint16_t)buffer);
+        if (result == 0)
+            stream->closed = 1;
+        else
+            stream->error = result;
     }
 
-    io_uring_prep_write(sqe, fd, buffer, size, 0);
-    token->type = WRITE;
-    token->fd = fd;
-    token->cb = (Cb)cb;
-    token->data = data;
-    io_uring_sqe_set_data(sqe, (void *)token);
+    if (!(flags & IORING_CQE_F_MORE))
+        stream->armed = 0;
+    if (stream->waiter) {
+        push_ready_waiter(stream->ioc, stream->waiter);
+        stream->waiter = NULL;
+    }
+}
+
+int arm_recv_stream(struct RecvStream *stream)
+{
+    if (stream->armed)
+        return 0;
+
+    int ret = request_recv_multishot(stream->ioc, stream->fd,
+                                     &recv_stream_complete, stream);
+    if (unlikely(ret < 0))
+        return ret;
+
+    stream->armed = 1;
+    ++stream->arms;
     return 0;
 }
 
-int process(struct IOContext *ioc, size_t batch)
+void wake_token_waiters(struct IOContext *ioc)
+{
+    while (ioc->token_wait_head && ioc->tail > ioc->token_reserved) {
+        struct Waiter *waiter = ioc->token_wait_head;
+        ioc->token_wait_head = waiter->next;
+        if (!ioc->token_wait_head)
+            ioc->token_wait_tail = NULL;
+
+        ++ioc->token_reserved;
+        push_ready_waiter(ioc, waiter);
+    }
+}
+
+static int sleep_completions(struct IOContext *ioc)
+{
+    struct io_uring_cqe *cqe = NULL;
+    if (ioc->wait_timeout.tv_sec == 0 && ioc->wait_timeout.tv_nsec == 0)
+        return io_uring_submit_and_wait_timeout(&ioc->ring, &cqe, 1, NULL,
+                                                NULL);
+
+    // Requests in flight hold a token: never wait for more completions.
+    uint32_t in_flight = ioc->capacity - ioc->tail;
+    uint32_t completions = ioc->wait_completions < in_flight
+                               ? ioc->wait_completions
+                               : in_flight;
+    int ret = io_uring_submit_and_wait_timeout(
+        &ioc->ring, &cqe, completions ? completions : 1, &ioc->wait_timeout,
+        NULL);
+    ioc->stats.wait_timeouts += ret == -ETIME;
+    return ret;
+}
+
+#define SPIN_CHECK_INTERVAL 64
+
+static int spin_completions(struct IOContext *ioc, uint64_t start)
+{
+    uint64_t deadline = start + ioc->spin_budget_ns;
+    while (1) {
+        for (int i = 0; i < SPIN_CHECK_INTERVAL; ++i) {
+            if (io_uring_cq_ready(&ioc->ring))
+                return 1;
+
+            // Task work deferred by COOP_TASKRUN only runs in the kernel.
+            if (IO_URING_READ_ONCE(*ioc->ring.sq.kflags) & IORING_SQ_TASKRUN)
+                return 0;
+
+            cpu_relax();
+        }
+
+        if (now_ns() >= deadline)
+            return 0;
+    }
+}
+
+static void adapt_spin_budget(struct IOContext *ioc, uint64_t waited)
+{
+    ioc->wait_gap_ns = (ioc->wait_gap_ns * 7 + waited) / 8;
+
+    // Spinning cannot catch completions slower than the longest spin.
+    if (ioc->wait_gap_ns > ioc->spin_max_ns)
+        ioc->spin_budget_ns = 0;
+    else if (ioc->wait_gap_ns * 2 > ioc->spin_max_ns)
+        ioc->spin_budget_ns = ioc->spin_max_ns;
+    else
+        ioc->spin_budget_ns = (uint32_t)(ioc->wait_gap_ns * 2);
+}
+
+static int wait_completions(struct IOContext *ioc, unsigned pending,
+                            int submit_enters)
+{
+    uint64_t start = now_ns();
+    uint64_t sleep_start = start;
+    if (ioc->spin_budget_ns) {
+        // Spinning is only useful once the pending requests are submitted.
+        if (pending) {
+            ioc->stats.enters += submit_enters;
+            int ret = io_uring_submit(&ioc->ring);
+            if (unlikely(ret < 0 && ret != -EBUSY && ret != -EAGAIN))
+                return ret;
+        }
+
+        int hit = spin_completions(ioc, start);
+        sleep_start = now_ns();
+        uint64_t spun = sleep_start - start;
+        ++ioc->stats.spins;
+        ioc->stats.spin_ns += spun;
+        if (hit) {
+            ++ioc->stats.spin_hits;
+            adapt_spin_budget(ioc, spun);
+            return 0;
+        }
+    }
+
+    ++ioc->stats.enters;
+    ++ioc->stats.sleeps;
+    int ret = sleep_completions(ioc);
+
+    uint64_t end = now_ns();
+    ioc->stats.sleep_ns += end - sleep_start;
+    if (ioc->spin_max_ns)
+        adapt_spin_budget(ioc, end - start);
+
+    return ret;
+}
+
+// Release the buffer of a zero-copy send once no completion of it is left,
+// and tell whether the completion is the notification, which carries no
+// result for the requester.
+static inline int finish_send_zc(struct IOContext *ioc, struct Token *token,
+                                 const struct io_uring_cqe *cqe)
+{
+    if (cqe->flags & IORING_CQE_F_MORE)
+        return 0;
+
+    int notification = (cqe->flags & IORING_CQE_F_NOTIF) != 0;
+    ioc->stats.zc_sends += notification;
+    ioc->stats.zc_copied +=
+        notification && ((uint32_t)cqe->res & IORING_NOTIF_USAGE_ZC_COPIED);
+
+    struct Release *release = &ioc->releases[token - ioc->tokens];
+    if (release->cb)
+        release->cb(release->data);
+    return notification;
+}
+
+static void wake_sq_waiters(struct IOContext *ioc)
+{
+    struct Waiter *waiter = ioc->sq_wait_head;
+    ioc->sq_wait_head = NULL;
+    ioc->sq_wait_tail = NULL;
+
+    while (waiter) {
+        struct Waiter *next = waiter->next;
+        push_ready_waiter(ioc, waiter);
+        waiter = next;
+    }
+}
+
+static int process_completions(struct IOContext *ioc, size_t batch,
+                               int may_wait)
 {
     static __thread struct io_uring_cqe *cqes[MAX_BATCH_SIZE];
+    static __thread uint32_t released[MAX_BATCH_SIZE];
     if (unlikely(batch == 0))
         return batch;
 
     batch = batch > MAX_BATCH_SIZE ? MAX_BATCH_SIZE : batch;
     struct io_uring_cqe *cqe = NULL;
 
-    int ret = io_uring_submit(&ioc->ring);
-    if (unlikely(ret < 0))
-        return ret;
+    // A sleeping SQPOLL thread is woken up by io_uring_submit, at the cost
+    // of a system call. Count them to tune `sq_thread_idle`.
+    int sqpoll = ioc->setup_flags & IORING_SETUP_SQPOLL;
+    int wakeup = sqpoll && (IO_URING_READ_ONCE(*ioc->ring.sq.kflags) &
+                            IORING_SQ_NEED_WAKEUP);
+    ioc->stats.sq_wakeups += wakeup;
 
-    unsigned count = io_uring_peek_batch_cqe(&ioc->ring, cqes, batch);
-    if (count == 0) {
-        int peek_result = io_uring_wait_cqe(&ioc->ring, cqes);
-        if (unlikely(peek_result != 0))
-            return peek_result;
+    // Block only when nothing can run: waiters parked on a full submission
+    // queue become ready as soon as it is submitted.
+    int wait = may_wait && !ioc->ready_head && !ioc->sq_wait_head &&
+               io_uring_cq_ready(&ioc->ring) == 0;
+    unsigned pending = io_uring_sq_ready(&ioc->ring);
 
-        count = 1;
+    int ret = 0;
+    if (wait) {
+        ret = wait_completions(ioc, pending, !sqpoll || wakeup);
+    } else if (pending) {
+        ioc->stats.enters += !sqpoll || wakeup;
+        ret = io_uring_submit(&ioc->ring);
     }
+    if (unlikely(ret < 0 && ret != -EBUSY && ret != -EAGAIN &&
+                 ret != -ETIME && ret != -EINTR))
+        return ret;
+
+    wake_sq_waiters(ioc);
+
+    unsigned count = io_uring_peek_batch_cqe(&ioc->ring, cqes, batch);
+    if (count == 0)
+        return 0;
 
+    uint32_t release_count = 0;
     for (unsigned i = 0; i < count; ++i) {
         cqe = cqes[i];
-        struct Token *token = (struct Token *)cqe->user_data;
-        if (unlikely(token == NULL))
+        struct Token *token = token_from_user_data(ioc, cqe->user_data);
+        // The wakeup and the linked timeouts complete without a token.
+        if (unlikely(token == NULL)) {
+            if (cqe->user_data == WAKEUP_USER_DATA)
+                ioc->wakeup_ns = 0;
             continue;
+        }
+
+        ioc->provided.available -= (cqe->flags & IORING_CQE_F_BUFFER) != 0;
+
+        // A multishot request keeps its token until its last completion.
+        if (likely(!(cqe->flags & IORING_CQE_F_MORE)))
+            released[release_count++] = (uint32_t)(token - ioc->tokens);
+        if (unlikely(token->type == SEND_ZC) && finish_send_zc(ioc, token, cqe))
+            continue;
+
+        // A request cancelled by its linked timeout missed its deadline.
+        int result = cqe->res;
+        if (unlikely(token->flags & TOKEN_DEADLINE) && result == -ECANCELED) {
+            ++ioc->stats.deadlines_expired;
+            result = -ETIME;
+        }
+
+        if (likely(token->cb == NULL)) {
+            struct Waiter *waiter = (struct Waiter *)token->data;
+            // Nobody owns the buffer a stale receive picked: give it back.
+            if (unlikely(waiter->user_data != cqe->user_data)) {
+                int buffer = completion_buffer(cqe->flags);
+                if (buffer >= 0)
+                    recycle_buffer(ioc, (uint16_t)buffer);
+                continue;
+            }
+
+            waiter->result = result;
+            waiter->flags = cqe->flags;
+            push_ready_waiter(ioc, waiter);
+            continue;
+        }
 
         switch (token->type) {
         case ACCEPT:
-            ((accept_cb)token->cb)(cqe->res, token->data);
+            ((accept_cb)token->cb)(result, token->data);
             break;
         case READ:
-            ((read_cb)token->cb)(cqe->res, token->data);
+        case READV:
+        case RECVMSG:
+            ((read_cb)token->cb)(result, token->data);
             break;
         case WRITE:
-            ((write_cb)token->cb)(cqe->res, token->data);
+        case WRITEV:
+        case SENDMSG:
+        case SEND_ZC:
+            ((write_cb)token->cb)(result, token->data);
             break;
         case WAIT:
             ((wait_cb)token->cb)(token->data);
             break;
+        case RECV:
+            ((recv_cb)token->cb)(result, completion_buffer(cqe->flags),
+                                 token->data);
+            break;
+        case SOCKET:
+        case CONNECT:
+        case SHUTDOWN:
+        case CLOSE:
+        case CANCEL:
+            ((status_cb)token->cb)(result, token->data);
+            break;
+        case MULTISHOT:
+            ((multishot_cb)token->cb)(result, cqe->flags, token->data);
+            break;
         default:
             break;
         }
-        // TODO: release token in batch
-        release_token(ioc, token);
     }
 
     io_uring_cq_advance(&ioc->ring, count);
+    release_tokens(ioc, released, release_count);
     return count;
 }
+
+int process(struct IOContext *ioc, size_t batch)
+{
+    return process_completions(ioc, batch, 1);
+}
+
+int process_nowait(struct IOContext *ioc, size_t batch)
+{
+    return process_completions(ioc, batch, 0);
+}
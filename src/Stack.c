@@ -0,0 +1,202 @@
+#include "Stack.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Common.h"
+
+size_t stack_page_size(void)
+{
+    static size_t page_size = 0;
+    if (unlikely(page_size == 0)) {
+        long size = sysconf(_SC_PAGESIZE);
+        page_size = size > 0 ? (size_t)size : 4096;
+    }
+
+    return page_size;
+}
+
+size_t stack_round_size(size_t size)
+{
+    size_t page = stack_page_size();
+    if (size < page)
+        return page;
+
+    return (size + page - 1) & ~(page - 1);
+}
+
+int allocate_stack(struct Stack *stack, size_t size)
+{
+    if (!stack || !size)
+        return -1;
+
+    size_t page = stack_page_size();
+    size = stack_round_size(size);
+
+    void *memory = mmap(NULL, size + page, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) {
+        LOG_ERROR("unable to map stack of %zu bytes\n", size);
+        return -1;
+    }
+
+    if (mprotect(memory, page, PROT_NONE) < 0) {
+        LOG_ERROR("unable to protect stack guard page\n");
+        munmap(memory, size + page);
+        return -1;
+    }
+
+    stack->memory = memory;
+    stack->size = size;
+    return 0;
+}
+
+void free_stack(struct Stack *stack)
+{
+    if (!stack || !stack->memory)
+        return;
+
+    munmap(stack->memory, stack->size + stack_page_size());
+    memset(stack, 0, sizeof(*stack));
+}
+
+static size_t stack_class(size_t size)
+{
+    size_t pages = stack_round_size(size) / stack_page_size();
+    size_t index = 0;
+    while (((size_t)1 << index) < pages)
+        ++index;
+
+    return index;
+}
+
+static size_t stack_class_size(size_t index)
+{
+    return stack_page_size() << index;
+}
+
+static void trim_stack_pool(struct StackPool *pool, size_t target)
+{
+    for (size_t i = STACK_CLASS_COUNT; i-- > 0;) {
+        struct StackClass *class = &pool->classes[i];
+        while (class->cold + 1 < class->count &&
+               pool->cached_resident > target) {
+            struct Stack *stack = &class->stacks[class->cold++];
+            madvise(stack_bottom(stack), stack->size, MADV_DONTNEED);
+            pool->cached_resident -= stack->size;
+            pool->stats.resident_bytes -= stack->size;
+            ++pool->stats.trims;
+        }
+    }
+}
+
+int init_stack_pool(struct StackPool *pool, size_t high_water)
+{
+    if (!pool)
+        return -1;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->high_water = high_water;
+    return 0;
+}
+
+void free_pending_stack(struct StackPool *pool)
+{
+    if (likely(!pool->pending.memory))
+        return;
+
+    pool->stats.mapped_bytes -= pool->pending.size;
+    pool->stats.resident_bytes -= pool->pending.size;
+    free_stack(&pool->pending);
+}
+
+void free_stack_pool(struct StackPool *pool)
+{
+    if (!pool)
+        return;
+
+    free_pending_stack(pool);
+    for (size_t i = 0; i < STACK_CLASS_COUNT; ++i) {
+        struct StackClass *class = &pool->classes[i];
+        for (size_t j = 0; j < class->count; ++j)
+            free_stack(&class->stacks[j]);
+        free(class->stacks);
+    }
+
+    memset(pool, 0, sizeof(*pool));
+}
+
+int acquire_stack(struct StackPool *pool, struct Stack *stack, size_t size)
+{
+    free_pending_stack(pool);
+
+    size_t index = stack_class(size);
+    if (likely(index < STACK_CLASS_COUNT)) {
+        struct StackClass *class = &pool->classes[index];
+        if (likely(class->count > 0)) {
+            *stack = class->stacks[--class->count];
+            if (class->count < class->cold) {
+                class->cold = class->count;
+                pool->stats.resident_bytes += stack->size;
+            } else {
+                pool->cached_resident -= stack->size;
+            }
+            pool->stats.cached_bytes -= stack->size;
+            ++pool->stats.hits;
+            return 0;
+        }
+        size = stack_class_size(index);
+    }
+
+    if (allocate_stack(stack, size) < 0)
+        return -1;
+
+    pool->stats.mapped_bytes += stack->size;
+    pool->stats.resident_bytes += stack->size;
+    ++pool->stats.misses;
+    return 0;
+}
+
+static int reserve_stack_class(struct StackClass *class)
+{
+    if (likely(class->count < class->capacity))
+        return 0;
+
+    size_t capacity = class->capacity ? class->capacity * 2 : 16;
+    struct Stack *stacks =
+        (struct Stack *)realloc(class->stacks, capacity * sizeof(struct Stack));
+    if (!stacks)
+        return -1;
+
+    class->stacks = stacks;
+    class->capacity = capacity;
+    return 0;
+}
+
+void release_stack(struct StackPool *pool, struct Stack *stack)
+{
+    if (!stack->memory)
+        return;
+
+    size_t index = stack_class(stack->size);
+    if (unlikely(index >= STACK_CLASS_COUNT ||
+                 reserve_stack_class(&pool->classes[index]) < 0)) {
+        // The caller may be running on it: unmap it once it switched away.
+        free_pending_stack(pool);
+        pool->pending = *stack;
+        memset(stack, 0, sizeof(*stack));
+        return;
+    }
+
+    struct StackClass *class = &pool->classes[index];
+
+    class->stacks[class->count++] = *stack;
+    pool->cached_resident += stack->size;
+    pool->stats.cached_bytes += stack->size;
+    memset(stack, 0, sizeof(*stack));
+
+    if (pool->cached_resident > pool->high_water)
+        trim_stack_pool(pool, pool->high_water / 2);
+}
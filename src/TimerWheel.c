@@ -0,0 +1,203 @@
+#include "TimerWheel.h"
+
+#include <string.h>
+
+#include "Common.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_SPAN (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+// The occupied slots of a level are the bits of a uint64_t.
+_Static_assert(TIMER_WHEEL_SLOTS <= 64, "too many slots per level");
+
+void init_timer_wheel(struct TimerWheel *wheel, uint64_t now_ns)
+{
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now_ns = now_ns;
+    wheel->tick = now_ns / TIMER_TICK_NS;
+}
+
+void init_timer(struct Timer *timer, timer_cb cb, void *data)
+{
+    memset(timer, 0, sizeof(*timer));
+    timer->cb = cb;
+    timer->data = data;
+}
+
+static void link_timer(struct TimerWheel *wheel, struct Timer *timer,
+                       uint64_t base)
+{
+    // Timers further away than the wheel spans wait in its last level.
+    uint64_t delta = timer->expires > base ? timer->expires - base : 0;
+    if (unlikely(delta >= TIMER_WHEEL_SPAN))
+        delta = TIMER_WHEEL_SPAN - 1;
+
+    uint32_t level = delta < TIMER_WHEEL_SLOTS
+                         ? 0
+                         : (uint32_t)(63 - __builtin_clzll(delta)) /
+                               TIMER_WHEEL_BITS;
+    uint32_t index =
+        (uint32_t)((base + delta) >> (level * TIMER_WHEEL_BITS)) &
+        TIMER_WHEEL_MASK;
+
+    timer->slot = level * TIMER_WHEEL_SLOTS + index;
+    struct Timer **head = &wheel->slots[timer->slot];
+    timer->next = *head;
+    if (timer->next)
+        timer->next->prev = &timer->next;
+    timer->prev = head;
+    *head = timer;
+    wheel->occupied[level] |= 1ULL << index;
+}
+
+static void unlink_timer(struct TimerWheel *wheel, struct Timer *timer)
+{
+    *timer->prev = timer->next;
+    if (timer->next)
+        timer->next->prev = timer->prev;
+
+    // Timers being fired are off the wheel, whose slot may be reused.
+    if (!wheel->slots[timer->slot])
+        wheel->occupied[timer->slot / TIMER_WHEEL_SLOTS] &=
+            ~(1ULL << (timer->slot & TIMER_WHEEL_MASK));
+
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+void arm_timer(struct TimerWheel *wheel, struct Timer *timer,
+               uint64_t deadline_ns)
+{
+    if (timer->prev)
+        unlink_timer(wheel, timer);
+    else
+        ++wheel->count;
+
+    // Round up, so that the timer never fires before its deadline.
+    timer->expires = deadline_ns / TIMER_TICK_NS +
+                     (deadline_ns % TIMER_TICK_NS != 0);
+    link_timer(wheel, timer, wheel->tick);
+}
+
+int cancel_timer(struct TimerWheel *wheel, struct Timer *timer)
+{
+    if (!timer->prev)
+        return 0;
+
+    unlink_timer(wheel, timer);
+    --wheel->count;
+    return 1;
+}
+
+// Find the next tick at which a slot is due: a slot of the first level
+// fires, one of an upper level moves its timers down at the start of its
+// span. Upper levels may hold timers in their current slot for their next
+// turn, which only comes once the whole level went round.
+static uint64_t next_event_tick(const struct TimerWheel *wheel)
+{
+    uint64_t next = UINT64_MAX;
+    for (uint32_t level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+        uint64_t bits = wheel->occupied[level];
+        if (!bits)
+            continue;
+
+        uint32_t shift = level * TIMER_WHEEL_BITS;
+        uint64_t position = wheel->tick >> shift;
+        uint32_t index = (uint32_t)position & TIMER_WHEEL_MASK;
+        if (index)
+            bits = bits >> index | bits << (TIMER_WHEEL_SLOTS - index);
+
+        uint64_t distance;
+        if ((wheel->tick & ((1ULL << shift) - 1)) && (bits & 1)) {
+            bits &= ~1ULL;
+            distance = bits ? (uint64_t)__builtin_ctzll(bits)
+                            : TIMER_WHEEL_SLOTS;
+        } else {
+            distance = (uint64_t)__builtin_ctzll(bits);
+        }
+
+        uint64_t event = (position + distance) << shift;
+        if (event < next)
+            next = event;
+    }
+
+    return next;
+}
+
+static size_t process_tick(struct TimerWheel *wheel, uint64_t tick)
+{
+    // Move the timers of the upper slots starting at this tick down, from
+    // the top, so that those due now end up in the first level.
+    for (uint32_t level = TIMER_WHEEL_LEVELS - 1; level > 0; --level) {
+        uint32_t shift = level * TIMER_WHEEL_BITS;
+        if (tick & ((1ULL << shift) - 1))
+            continue;
+
+        uint32_t index = (uint32_t)(tick >> shift) & TIMER_WHEEL_MASK;
+        struct Timer **head = &wheel->slots[level * TIMER_WHEEL_SLOTS + index];
+        struct Timer *list = *head;
+        if (!list)
+            continue;
+
+        *head = NULL;
+        wheel->occupied[level] &= ~(1ULL << index);
+        while (list) {
+            struct Timer *timer = list;
+            list = timer->next;
+            link_timer(wheel, timer, tick);
+        }
+    }
+
+    uint32_t index = (uint32_t)tick & TIMER_WHEEL_MASK;
+    struct Timer *list = wheel->slots[index];
+    wheel->slots[index] = NULL;
+    wheel->occupied[0] &= ~(1ULL << index);
+    wheel->tick = tick + 1;
+
+    // Callbacks may cancel the timers left in the list, which unlink from
+    // it through their prev pointer.
+    size_t fired = 0;
+    if (list)
+        list->prev = &list;
+    while (list) {
+        struct Timer *timer = list;
+        list = timer->next;
+        if (list)
+            list->prev = &list;
+
+        timer->next = NULL;
+        timer->prev = NULL;
+        --wheel->count;
+        ++fired;
+        timer->cb(timer->data);
+    }
+
+    return fired;
+}
+
+size_t advance_timer_wheel(struct TimerWheel *wheel, uint64_t now_ns)
+{
+    uint64_t target = now_ns / TIMER_TICK_NS;
+    size_t fired = 0;
+
+    wheel->now_ns = now_ns;
+    while (wheel->count) {
+        uint64_t next = next_event_tick(wheel);
+        if (next > target)
+            break;
+        fired += process_tick(wheel, next);
+    }
+
+    // Nothing is due until the next event, so the ticks before are skipped.
+    if (wheel->tick <= target)
+        wheel->tick = target + 1;
+    return fired;
+}
+
+uint64_t next_timer_deadline(const struct TimerWheel *wheel)
+{
+    if (!wheel->count)
+        return NO_TIMER_DEADLINE;
+
+    return next_event_tick(wheel) * TIMER_TICK_NS;
+}
@@ -1,4 +1,8 @@
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include <Executor.h>
 #include "utils.h"
@@ -55,9 +59,966 @@ int executor_invalid_free(void)
     return 0;
 }
 
+static void waiting_task(struct Executor *executor, void *data)
+{
+    struct __kernel_timespec ts;
+    msec_to_ts(&ts, 1);
+
+    MAYBE_UNUSED int ret = async_wait(executor, &ts);
+    assert(ret == 0);
+    ++*(int *)data;
+}
+
+static void spawning_task(struct Executor *executor, void *data)
+{
+    for (int i = 0; i < 4; ++i) {
+        MAYBE_UNUSED int ret = async_exec(executor, &waiting_task, data);
+        assert(ret == 0);
+    }
+    ++*(int *)data;
+}
+
+int executor_run_tasks(void)
+{
+    struct Executor exe;
+    int counter = 0;
+
+    if (init_executor(&exe, 16, 32) < 0)
+        return -1;
+
+    for (int i = 0; i < 3; ++i)
+        async_exec(&exe, &spawning_task, &counter);
+
+    run(&exe);
+    assert(exe.size == 1);
+
+    free_executor(&exe);
+    return counter == 15 ? 0 : -1;
+}
+
+static void large_stack_task(struct Executor *executor, void *data)
+{
+    unsigned char buffer[128 * 1024];
+    memset(buffer, 0xAB, sizeof(buffer));
+
+    struct __kernel_timespec ts;
+    msec_to_ts(&ts, 1);
+    async_wait(executor, &ts);
+
+    if (buffer[0] == 0xAB && buffer[sizeof(buffer) - 1] == 0xAB)
+        ++*(int *)data;
+}
+
+static void small_stack_task(struct Executor *executor, void *data)
+{
+    struct __kernel_timespec ts;
+    msec_to_ts(&ts, 1);
+    async_wait(executor, &ts);
+    ++*(int *)data;
+}
+
+int executor_stack_sizes(void)
+{
+    struct Executor exe;
+    int counter = 0;
+
+    if (init_executor(&exe, 4, 8) < 0)
+        return -1;
+
+    async_exec_with_stack(&exe, &large_stack_task, &counter, 256 * 1024);
+    async_exec_with_stack(&exe, &small_stack_task, &counter, 1);
+    async_exec(&exe, &small_stack_task, &counter);
+
+    assert(exe.frames[1]->stack.size == 256 * 1024);
+    assert(exe.frames[2]->stack.size == stack_page_size());
+    assert(exe.frames[3]->stack.size == stack_round_size(STACK_SIZE));
+
+    run(&exe);
+    free_executor(&exe);
+    return counter == 3 ? 0 : -1;
+}
+
+static void oversize_stack_task(struct Executor *executor, void *data)
+{
+    volatile unsigned char buffer[4096];
+    buffer[0] = 1;
+
+    struct __kernel_timespec ts;
+    msec_to_ts(&ts, 1);
+    async_wait(executor, &ts);
+    *(int *)data += buffer[0];
+}
+
+int executor_oversize_stack(void)
+{
+    struct Executor exe;
+    int counter = 0;
+    size_t size = stack_page_size() << STACK_CLASS_COUNT;
+
+    if (init_executor(&exe, 4, 8) < 0)
+        return -1;
+
+    // Stacks beyond the size classes are unmapped once their task is gone.
+    for (int i = 0; i < 2; ++i)
+        async_exec_with_stack(&exe, &oversize_stack_task, &counter, size);
+    assert(exe.frames[1]->stack.size == size);
+
+    run(&exe);
+    MAYBE_UNUSED size_t mapped = exe.stacks.stats.mapped_bytes;
+    assert(mapped == 0);
+    assert(exe.stacks.pending.memory == NULL);
+
+    free_executor(&exe);
+    return counter == 2 ? 0 : -1;
+}
+
+int executor_grow(void)
+{
+    struct Executor exe;
+    int counter = 0;
+
+    if (init_executor(&exe, 1, 128) < 0)
+        return -1;
+
+    MAYBE_UNUSED size_t initial_capacity = exe.capacity;
+    async_exec(&exe, &waiting_task, &counter);
+    MAYBE_UNUSED struct Frame *first = exe.frames[1];
+
+    for (int i = 0; i < 99; ++i) {
+        MAYBE_UNUSED int ret = async_exec(&exe, &waiting_task, &counter);
+        assert(ret == 0);
+    }
+
+    assert(exe.size == 101);
+    assert(exe.capacity > initial_capacity);
+    assert(exe.frames[1] == first);
+    assert(first->index == 1);
+
+    run(&exe);
+    assert(exe.size == 1);
+
+    free_executor(&exe);
+    return counter == 100 ? 0 : -1;
+}
+
+int executor_frame_limit(void)
+{
+    struct Executor exe;
+    int counter = 0;
+
+    if (init_executor(&exe, 1, 128) < 0)
+        return -1;
+
+    set_frame_limit(&exe, 3);
+    for (int i = 0; i < 3; ++i) {
+        MAYBE_UNUSED int ret = async_exec(&exe, &waiting_task, &counter);
+        assert(ret == 0);
+    }
+
+    int ret = async_exec(&exe, &waiting_task, &counter);
+    assert(exe.capacity == 4);
+    assert(set_frame_limit(&exe, 1) == -1);
+
+    run(&exe);
+    free_executor(&exe);
+    return ret == -1 && counter == 3 ? 0 : -1;
+}
+
+struct PipeWriter {
+    int fd;
+    int counter;
+};
+
+static void pipe_writing_task(struct Executor *executor, void *data)
+{
+    struct PipeWriter *writer = (struct PipeWriter *)data;
+    if (async_write(executor, writer->fd, "x", 1) == 1)
+        ++writer->counter;
+}
+
+int executor_token_back_pressure(void)
+{
+    struct Executor exe;
+    struct PipeWriter writer = { .counter = 0 };
+    int fds[2];
+    char bytes[64];
+
+    if (pipe(fds) < 0)
+        return -1;
+
+    if (init_executor(&exe, 64, 4) < 0)
+        return -1;
+
+    // Sleeps use no token, so the tasks hold tokens with writes instead.
+    writer.fd = fds[1];
+    for (int i = 0; i < 50; ++i)
+        async_exec(&exe, &pipe_writing_task, &writer);
+
+    run(&exe);
+    assert(exe.ioc.stats.token_waits > 0);
+    assert(exe.ioc.stats.token_wait_ns >= exe.ioc.stats.token_wait_max_ns);
+    assert(exe.ioc.token_reserved == 0);
+    assert(exe.ioc.tail == exe.ioc.capacity);
+
+    free_executor(&exe);
+    MAYBE_UNUSED ssize_t got = read(fds[0], bytes, sizeof(bytes));
+    assert(got == 50);
+    close(fds[0]);
+    close(fds[1]);
+    return writer.counter == 50 ? 0 : -1;
+}
+
+int executor_setup_flags(void)
+{
+    struct Executor exe;
+    struct IOContextOptions options = {
+        .flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN,
+    };
+    int counter = 0;
+
+    if (init_executor_with_options(&exe, 8, 32, &options) < 0)
+        return -1;
+
+    for (int i = 0; i < 3; ++i)
+        async_exec(&exe, &spawning_task, &counter);
+
+    run(&exe);
+    free_executor(&exe);
+    return counter == 15 ? 0 : -1;
+}
+
+int executor_sqpoll(void)
+{
+    struct Executor exe;
+    struct IOContextOptions options = {
+        .flags = IORING_SETUP_SQPOLL | IORING_SETUP_SQ_AFF,
+        .sq_thread_idle = 1,
+        .sq_thread_cpu = 0,
+    };
+    int counter = 0;
+
+    if (init_executor_with_options(&exe, 8, 32, &options) < 0)
+        return -1;
+
+    // Waits of 1 ms let the polling thread go idle between the batches.
+    for (int i = 0; i < 3; ++i)
+        async_exec(&exe, &spawning_task, &counter);
+
+    run(&exe);
+
+    MAYBE_UNUSED uint32_t flags = exe.ioc.setup_flags;
+    assert((flags & IORING_SETUP_SQPOLL) || exe.ioc.stats.sq_wakeups == 0);
+
+    free_executor(&exe);
+    return counter == 15 ? 0 : -1;
+}
+
+static void receiving_task(struct Executor *executor, void *data)
+{
+    int fd = *(int *)data;
+    struct __kernel_timespec ts;
+    msec_to_ts(&ts, 1);
+
+    // The buffer is held across a wait, so the other receiver finds the
+    // ring empty and waits for it.
+    uint16_t id = 0;
+    ssize_t length = async_recv_select(executor, fd, &id);
+    if (length == 1 && *(char *)provided_buffer(&executor->ioc, id) == 'x') {
+        async_wait(executor, &ts);
+        recycle_buffer(&executor->ioc, id);
+        write(fd, "y", 1);
+    }
+}
+
+int executor_recv_buffer_ring(void)
+{
+    struct Executor exe;
+    int fds[2][2];
+    char byte[2] = { 0, 0 };
+
+    for (int i = 0; i < 2; ++i)
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds[i]) < 0)
+            return -1;
+
+    if (init_executor(&exe, 8, 32) < 0 ||
+        register_buffer_ring(&exe.ioc, 64, 1) < 0)
+        return -1;
+
+    for (int i = 0; i < 2; ++i) {
+        async_exec(&exe, &receiving_task, &fds[i][0]);
+        MAYBE_UNUSED ssize_t length = write(fds[i][1], "x", 1);
+    }
+
+    run(&exe);
+    for (int i = 0; i < 2; ++i) {
+        MAYBE_UNUSED ssize_t length = read(fds[i][1], &byte[i], 1);
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+
+    free_executor(&exe);
+    return byte[0] == 'y' && byte[1] == 'y' ? 0 : -1;
+}
+
+static void accepting_task(struct Executor *executor, void *data)
+{
+    struct Acceptor *acceptor = (struct Acceptor *)data;
+
+    for (int i = 0; i < 2; ++i) {
+        int fd = async_accept_next(executor, acceptor);
+        if (fd < 0)
+            return;
+        close(fd);
+    }
+}
+
+int executor_accept_next(void)
+{
+    struct Executor exe;
+    struct Acceptor acceptor;
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int clients[4];
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        listen(server, 8) < 0 ||
+        getsockname(server, (struct sockaddr *)&address, &length) < 0)
+        return -1;
+
+    if (init_executor(&exe, 8, 32) < 0 ||
+        init_acceptor(&acceptor, &exe.ioc, server, 2) < 0)
+        return -1;
+
+    // Two tasks share the connections of a single multishot request, and
+    // the queue grows when more connections are accepted than it holds.
+    for (int i = 0; i < 2; ++i)
+        async_exec(&exe, &accepting_task, &acceptor);
+    for (int i = 0; i < 4; ++i) {
+        clients[i] = socket(AF_INET, SOCK_STREAM, 0);
+        MAYBE_UNUSED int ret =
+            connect(clients[i], (struct sockaddr *)&address, sizeof(address));
+        assert(ret == 0);
+    }
+
+    run(&exe);
+    int accepted = (int)acceptor.accepted - (int)acceptor.dropped;
+    MAYBE_UNUSED uint64_t arms = acceptor.arms;
+    assert(arms == 1);
+
+    free_executor(&exe);
+    free_acceptor(&acceptor);
+    for (int i = 0; i < 4; ++i)
+        close(clients[i]);
+    close(server);
+    return accepted == 4 ? 0 : -1;
+}
+
+struct Stream {
+    int fd;
+    uint64_t arms;
+    size_t received;
+};
+
+static void streaming_task(struct Executor *executor, void *data)
+{
+    struct Stream *result = (struct Stream *)data;
+    struct RecvStream stream;
+    if (init_recv_stream(&stream, &executor->ioc, result->fd) < 0)
+        return;
+
+    uint16_t id = 0;
+    ssize_t length;
+    while ((length = async_recv_next(executor, &stream, &id)) > 0) {
+        const char *buffer = (const char *)provided_buffer(&executor->ioc, id);
+        for (ssize_t i = 0; i < length; ++i)
+            if (buffer[i] == (char)result->received)
+                ++result->received;
+        recycle_buffer(&executor->ioc, id);
+    }
+
+    result->arms = stream.arms;
+    free_recv_stream(&stream);
+}
+
+int executor_recv_next(void)
+{
+    struct Executor exe;
+    struct Stream result = { .received = 0 };
+    char message[192];
+    int fds[2];
+
+    for (size_t i = 0; i < sizeof(message); ++i)
+        message[i] = (char)i;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return -1;
+
+    if (init_executor(&exe, 8, 32) < 0 ||
+        register_buffer_ring(&exe.ioc, 64, 2) < 0)
+        return -1;
+
+    // The message needs three buffers of the ring of two, so the request
+    // ends once the ring runs dry and is armed again.
+    MAYBE_UNUSED ssize_t length = write(fds[1], message, sizeof(message));
+    shutdown(fds[1], SHUT_WR);
+    result.fd = fds[0];
+    async_exec(&exe, &streaming_task, &result);
+
+    run(&exe);
+    free_executor(&exe);
+    close(fds[0]);
+    close(fds[1]);
+    return result.received == sizeof(message) && result.arms >= 2 ? 0 : -1;
+}
+
+#define ZC_MESSAGE_SIZE (64 * 1024)
+
+struct ZeroCopy {
+    int fd;
+    char *message;
+    ssize_t sent;
+    int releases;
+    struct Executor *executor;
+    struct Frame *sender;
+};
+
+static void release_message(void *data)
+{
+    struct ZeroCopy *zc = (struct ZeroCopy *)data;
+    ++zc->releases;
+    if (zc->sender)
+        push_ready_frame(zc->executor, zc->sender);
+}
+
+static void zero_copy_task(struct Executor *executor, void *data)
+{
+    struct ZeroCopy *zc = (struct ZeroCopy *)data;
+
+    zc->executor = executor;
+    zc->sent = async_send_zc(executor, zc->fd, zc->message, ZC_MESSAGE_SIZE,
+                             &release_message, zc);
+
+    // The executor stops with its last task, so wait for the notification.
+    if (zc->releases == 0) {
+        zc->sender = get_current_frame(executor);
+        suspend_current_frame(executor);
+    }
+}
+
+int executor_send_zc(void)
+{
+    struct Executor exe;
+    struct ZeroCopy zc = { .sent = 0 };
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        listen(server, 1) < 0 ||
+        getsockname(server, (struct sockaddr *)&address, &length) < 0 ||
+        connect(client, (struct sockaddr *)&address, sizeof(address)) < 0)
+        return -1;
+
+    // Zero-copy sends need a real socket: socketpairs do not support them.
+    zc.fd = accept(server, NULL, NULL);
+    zc.message = malloc(2 * ZC_MESSAGE_SIZE);
+    if (zc.fd < 0 || !zc.message || init_executor(&exe, 8, 32) < 0)
+        return -1;
+
+    char *received = zc.message + ZC_MESSAGE_SIZE;
+    memset(zc.message, 'z', ZC_MESSAGE_SIZE);
+
+    async_exec(&exe, &zero_copy_task, &zc);
+    run(&exe);
+    free_executor(&exe);
+
+    ssize_t count = recv(client, received, ZC_MESSAGE_SIZE, MSG_WAITALL);
+    int ret = zc.sent == ZC_MESSAGE_SIZE && zc.releases == 1 &&
+                      count == ZC_MESSAGE_SIZE &&
+                      received[ZC_MESSAGE_SIZE - 1] == 'z'
+                  ? 0
+                  : -1;
+
+    free(zc.message);
+    close(zc.fd);
+    close(client);
+    close(server);
+    return ret;
+}
+
+struct Vectored {
+    int fds[2];
+    int checks;
+};
+
+static void vectored_task(struct Executor *executor, void *data)
+{
+    struct Vectored *vectored = (struct Vectored *)data;
+    char header[4] = "HEAD";
+    char body[12] = "body of text";
+    char received[2][16];
+    struct iovec out[2] = { { header, sizeof(header) }, { body, sizeof(body) } };
+    struct iovec in[2] = { { received[0], 4 }, { received[0] + 4, 12 } };
+
+    // Header and body leave in a single write and come back split.
+    if (async_writev(executor, vectored->fds[1], out, 2) == 16 &&
+        async_readv(executor, vectored->fds[0], in, 2) == 16 &&
+        memcmp(received[0], "HEADbody of text", 16) == 0)
+        ++vectored->checks;
+
+    struct msghdr message = { .msg_iov = out, .msg_iovlen = 2 };
+    struct msghdr reply = { .msg_iov = &in[0], .msg_iovlen = 1 };
+    in[0].iov_base = received[1];
+    in[0].iov_len = sizeof(received[1]);
+    if (async_sendmsg(executor, vectored->fds[1], &message, MSG_NOSIGNAL) ==
+            16 &&
+        async_recvmsg(executor, vectored->fds[0], &reply, MSG_WAITALL) ==
+            16 &&
+        memcmp(received[1], "HEADbody of text", 16) == 0)
+        ++vectored->checks;
+
+    // Without MSG_NOSIGNAL, the closed peer would kill the test.
+    close(vectored->fds[0]);
+    if (async_sendmsg(executor, vectored->fds[1], &message, MSG_NOSIGNAL) ==
+        -EPIPE)
+        ++vectored->checks;
+}
+
+int executor_vectored_io(void)
+{
+    struct Executor exe;
+    struct Vectored vectored = { .checks = 0 };
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, vectored.fds) < 0 ||
+        init_executor(&exe, 8, 32) < 0)
+        return -1;
+
+    async_exec(&exe, &vectored_task, &vectored);
+    run(&exe);
+    free_executor(&exe);
+    close(vectored.fds[1]);
+    return vectored.checks == 3 ? 0 : -1;
+}
+
+struct Connection {
+    int server;
+    struct sockaddr_in address;
+    int checks;
+};
+
+static void connecting_task(struct Executor *executor, void *data)
+{
+    struct Connection *connection = (struct Connection *)data;
+    char byte;
+
+    int fd = async_socket(executor, AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return;
+
+    if (async_connect(executor, fd, (struct sockaddr *)&connection->address,
+                      sizeof(connection->address)) == 0)
+        ++connection->checks;
+
+    // The peer sees the end of the stream once the client shut it down.
+    int peer = async_accept(executor, connection->server);
+    if (peer >= 0 && async_shutdown(executor, fd, SHUT_WR) == 0 &&
+        async_read(executor, peer, &byte, 1) == 0)
+        ++connection->checks;
+
+    if (async_close(executor, fd) == 0 && async_close(executor, peer) == 0)
+        ++connection->checks;
+}
+
+int executor_connect_close(void)
+{
+    struct Executor exe;
+    struct Connection connection = { .checks = 0 };
+    socklen_t length = sizeof(connection.address);
+
+    connection.server = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&connection.address, 0, sizeof(connection.address));
+    connection.address.sin_family = AF_INET;
+    connection.address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(connection.server, (struct sockaddr *)&connection.address,
+             length) < 0 ||
+        listen(connection.server, 1) < 0 ||
+        getsockname(connection.server, (struct sockaddr *)&connection.address,
+                    &length) < 0)
+        return -1;
+
+    if (init_executor(&exe, 8, 32) < 0)
+        return -1;
+
+    async_exec(&exe, &connecting_task, &connection);
+    run(&exe);
+    free_executor(&exe);
+    close(connection.server);
+    return connection.checks == 3 ? 0 : -1;
+}
+
+struct Sleepers {
+    int order[3];
+    int woken;
+    int early;
+    int interrupted;
+    struct Frame *long_sleeper;
+};
+
+struct Sleeper {
+    struct Sleepers *sleepers;
+    int ms;
+};
+
+static void sleeping_task(struct Executor *executor, void *data)
+{
+    struct Sleeper *sleeper = (struct Sleeper *)data;
+    struct Sleepers *sleepers = sleeper->sleepers;
+    uint64_t deadline =
+        executor_now(executor) + (uint64_t)sleeper->ms * TIMER_TICK_NS;
+
+    if (async_sleep_until(executor, deadline) != 0 || now_ns() < deadline)
+        ++sleepers->early;
+    sleepers->order[sleepers->woken++] = sleeper->ms;
+}
+
+static void long_sleeping_task(struct Executor *executor, void *data)
+{
+    struct Sleepers *sleepers = (struct Sleepers *)data;
+    sleepers->long_sleeper = get_current_frame(executor);
+    if (async_sleep_until(executor, executor_now(executor) +
+                                        60000 * TIMER_TICK_NS) == -EINTR)
+        ++sleepers->interrupted;
+}
+
+static void waking_task(struct Executor *executor, void *data)
+{
+    struct Sleepers *sleepers = (struct Sleepers *)data;
+    async_sleep_until(executor, executor_now(executor) + TIMER_TICK_NS);
+    push_ready_frame(executor, sleepers->long_sleeper);
+}
+
+int executor_sleep_until(void)
+{
+    struct Executor exe;
+    struct Sleepers sleepers = { .woken = 0 };
+    struct Sleeper sleeper[3] = { { &sleepers, 3 },
+                                  { &sleepers, 1 },
+                                  { &sleepers, 2 } };
+
+    if (init_executor(&exe, 8, 32) < 0)
+        return -1;
+
+    for (int i = 0; i < 3; ++i)
+        async_exec(&exe, &sleeping_task, &sleeper[i]);
+    async_exec(&exe, &long_sleeping_task, &sleepers);
+    async_exec(&exe, &waking_task, &sleepers);
+    run(&exe);
+
+    // The early wake up cancelled the last timer, and no request is left.
+    MAYBE_UNUSED size_t armed = exe.timers.count;
+    assert(armed == 0);
+    free_executor(&exe);
+
+    return sleepers.woken == 3 && sleepers.early == 0 &&
+                   sleepers.interrupted == 1 && sleepers.order[0] == 1 &&
+                   sleepers.order[1] == 2 && sleepers.order[2] == 3
+               ? 0
+               : -1;
+}
+
+struct Deadlines {
+    int fds[2];
+    int server;
+    int checks;
+};
+
+static void deadline_task(struct Executor *executor, void *data)
+{
+    struct Deadlines *deadlines = (struct Deadlines *)data;
+    char byte = 'x';
+
+    uint64_t deadline = now_ns() + 5 * TIMER_TICK_NS;
+    if (async_read_until(executor, deadlines->fds[0], &byte, 1, deadline) ==
+            -ETIME &&
+        now_ns() >= deadline)
+        ++deadlines->checks;
+
+    deadline = now_ns() + 60000 * TIMER_TICK_NS;
+    if (async_write_until(executor, deadlines->fds[1], &byte, 1, deadline) ==
+            1 &&
+        async_read_until(executor, deadlines->fds[0], &byte, 1, deadline) == 1)
+        ++deadlines->checks;
+
+    deadline = now_ns() + TIMER_TICK_NS;
+    if (async_accept_until(executor, deadlines->server, deadline) == -ETIME)
+        ++deadlines->checks;
+}
+
+int executor_deadlines(void)
+{
+    struct Executor exe;
+    struct Deadlines deadlines = { .checks = 0 };
+
+    deadlines.server = socket(AF_INET, SOCK_STREAM, 0);
+    if (deadlines.server < 0 || listen(deadlines.server, 1) < 0 ||
+        pipe(deadlines.fds) < 0)
+        return -1;
+
+    if (init_executor(&exe, 8, 32) < 0)
+        return -1;
+
+    async_exec(&exe, &deadline_task, &deadlines);
+    run(&exe);
+
+    // The completions of the linked timeouts hold no token.
+    MAYBE_UNUSED uint64_t expired = exe.ioc.stats.deadlines_expired;
+    assert(expired == 2);
+    assert(exe.ioc.tail == exe.ioc.capacity);
+
+    free_executor(&exe);
+    close(deadlines.fds[0]);
+    close(deadlines.fds[1]);
+    close(deadlines.server);
+    return deadlines.checks == 3 ? 0 : -1;
+}
+
+struct Cancellation {
+    int fds[2];
+    int sockets[2];
+    struct TaskHandle reader;
+    ssize_t read_result;
+    struct Frame *leaked;
+    char byte;
+    char stale_byte;
+    int checks;
+};
+
+static void cancelled_reader_task(struct Executor *executor, void *data)
+{
+    struct Cancellation *cancellation = (struct Cancellation *)data;
+    cancellation->read_result =
+        async_read(executor, cancellation->fds[0], &cancellation->byte, 1);
+}
+
+static void cancelling_task(struct Executor *executor, void *data)
+{
+    struct Cancellation *cancellation = (struct Cancellation *)data;
+
+    if (async_cancel(executor, cancellation->reader) == 0 &&
+        async_cancel(executor, current_task(executor)) == -EINVAL)
+        ++cancellation->checks;
+
+    async_sleep_until(executor, executor_now(executor) + TIMER_TICK_NS);
+    if (!task_running(&cancellation->reader) &&
+        async_cancel(executor, cancellation->reader) == -ESRCH &&
+        cancellation->read_result == -ECANCELED)
+        ++cancellation->checks;
+}
+
+static void leaking_task(struct Executor *executor, void *data)
+{
+    struct Cancellation *cancellation = (struct Cancellation *)data;
+    struct Frame *frame = get_current_frame(executor);
+
+    // Finish with a read in flight, whose waiter is in the recycled frame.
+    cancellation->leaked = frame;
+    request_read(&executor->ioc, cancellation->fds[0],
+                 &cancellation->stale_byte, 1, NULL, &frame->waiter);
+}
+
+static void leaking_receiver_task(struct Executor *executor, void *data)
+{
+    struct Cancellation *cancellation = (struct Cancellation *)data;
+    struct Frame *frame = get_current_frame(executor);
+
+    // The stale completion holds a provided buffer nobody will give back.
+    cancellation->leaked = frame;
+    request_recv_select(&executor->ioc, cancellation->sockets[0], NULL,
+                        &frame->waiter);
+}
+
+static void recycled_task(struct Executor *executor, void *data)
+{
+    struct Cancellation *cancellation = (struct Cancellation *)data;
+    if (get_current_frame(executor) == cancellation->leaked &&
+        async_sleep_until(executor, executor_now(executor) +
+                                        5 * TIMER_TICK_NS) == 0)
+        ++cancellation->checks;
+}
+
+static void stale_writer_task(struct Executor *executor, void *data)
+{
+    struct Cancellation *cancellation = (struct Cancellation *)data;
+    async_sleep_until(executor, executor_now(executor) + TIMER_TICK_NS);
+    if (async_write(executor, cancellation->fds[1], "x", 1) == 1)
+        ++cancellation->checks;
+}
+
+static void stale_sender_task(struct Executor *executor, void *data)
+{
+    struct Cancellation *cancellation = (struct Cancellation *)data;
+    async_sleep_until(executor, executor_now(executor) + TIMER_TICK_NS);
+    if (async_write(executor, cancellation->sockets[1], "x", 1) == 1)
+        ++cancellation->checks;
+}
+
+int executor_cancel(void)
+{
+    struct Executor exe;
+    struct Cancellation cancellation = { .checks = 0 };
+    struct TaskHandle handle;
+
+    if (pipe(cancellation.fds) < 0 ||
+        socketpair(AF_UNIX, SOCK_STREAM, 0, cancellation.sockets) < 0)
+        return -1;
+
+    if (init_executor(&exe, 8, 32) < 0 ||
+        register_buffer_ring(&exe.ioc, 64, 2) < 0)
+        return -1;
+
+    async_spawn(&exe, &cancelled_reader_task, &cancellation,
+                &cancellation.reader);
+    async_exec(&exe, &cancelling_task, &cancellation);
+    run(&exe);
+
+    // The late completion of the leaked read must not resume the next task.
+    async_exec(&exe, &leaking_task, &cancellation);
+    run(&exe);
+    async_spawn(&exe, &recycled_task, &cancellation, &handle);
+    async_exec(&exe, &stale_writer_task, &cancellation);
+    run(&exe);
+
+    // Nor may it keep the buffer the kernel picked for the leaked receive.
+    async_exec(&exe, &leaking_receiver_task, &cancellation);
+    run(&exe);
+    async_spawn(&exe, &recycled_task, &cancellation, &handle);
+    async_exec(&exe, &stale_sender_task, &cancellation);
+    run(&exe);
+
+    MAYBE_UNUSED int running = task_running(&handle);
+    assert(running == 0);
+    assert(exe.ioc.tail == exe.ioc.capacity);
+    assert(exe.ioc.provided.available == exe.ioc.provided.count);
+    free_executor(&exe);
+    close(cancellation.fds[0]);
+    close(cancellation.fds[1]);
+    close(cancellation.sockets[0]);
+    close(cancellation.sockets[1]);
+    return cancellation.checks == 6 && cancellation.stale_byte == 'x' ? 0
+                                                                       : -1;
+}
+
+struct Fanout {
+    struct TaskHandle child;
+    uint64_t start;
+    int order[3];
+    int finished;
+    int joined;
+    int checks;
+};
+
+struct Backend {
+    struct Fanout *fanout;
+    int ms;
+};
+
+static void backend_task(struct Executor *executor, void *data)
+{
+    struct Backend *backend = (struct Backend *)data;
+    // Deadlines from a shared start stay ordered however late tasks begin.
+    async_sleep_until(executor, backend->fanout->start +
+                                    (uint64_t)backend->ms * TIMER_TICK_NS);
+    backend->fanout->order[backend->fanout->finished++] = backend->ms;
+}
+
+static void joining_task(struct Executor *executor, void *data)
+{
+    struct Fanout *fanout = (struct Fanout *)data;
+    if (async_join(executor, fanout->child) == 0 &&
+        !task_running(&fanout->child))
+        ++fanout->joined;
+}
+
+static void fanout_task(struct Executor *executor, void *data)
+{
+    struct Fanout *fanout = (struct Fanout *)data;
+    struct Backend backends[3] = { { fanout, 3 },
+                                   { fanout, 1 },
+                                   { fanout, 2 } };
+    struct TaskGroup group;
+
+    // A task joined by two others, and by its parent.
+    fanout->start = executor_now(executor);
+    async_spawn(executor, &backend_task, &backends[1], &fanout->child);
+    async_exec(executor, &joining_task, fanout);
+    async_exec(executor, &joining_task, fanout);
+    if (async_join(executor, current_task(executor)) == -EDEADLK &&
+        async_join(executor, fanout->child) == 0 && fanout->finished == 1 &&
+        async_join(executor, fanout->child) == 0)
+        ++fanout->checks;
+
+    fanout->finished = 0;
+    fanout->start = executor_now(executor);
+    init_task_group(&group);
+    for (int i = 0; i < 3; ++i)
+        async_group_spawn(executor, &group, &backend_task, &backends[i], NULL);
+
+    // On a loaded machine, more members may finish before the parent resumes.
+    ssize_t running = async_group_wait_any(executor, &group);
+    if (running == 3 - fanout->finished && running < 3 && fanout->order[0] == 1)
+        ++fanout->checks;
+
+    async_group_wait_all(executor, &group);
+    if (fanout->finished == 3 && fanout->order[1] == 2 &&
+        fanout->order[2] == 3 &&
+        async_group_wait_any(executor, &group) == -ENOENT)
+        ++fanout->checks;
+}
+
+int executor_join_group(void)
+{
+    struct Executor exe;
+    struct Fanout fanout = { .finished = 0 };
+
+    if (init_executor(&exe, 8, 32) < 0)
+        return -1;
+
+    async_exec(&exe, &fanout_task, &fanout);
+    run(&exe);
+    free_executor(&exe);
+    return fanout.checks == 3 && fanout.joined == 2 ? 0 : -1;
+}
+
 void run_executor_tests(void)
 {
     printf("executor_invalid_init %d\n", executor_invalid_init());
     printf("executor_valid_init %d\n", executor_valid_init());
     printf("executor_invalid_free %d\n", executor_invalid_free());
+    printf("executor_run_tasks %d\n", executor_run_tasks());
+    printf("executor_stack_sizes %d\n", executor_stack_sizes());
+    printf("executor_oversize_stack %d\n", executor_oversize_stack());
+    printf("executor_grow %d\n", executor_grow());
+    printf("executor_frame_limit %d\n", executor_frame_limit());
+    printf("executor_token_back_pressure %d\n",
+           executor_token_back_pressure());
+    printf("executor_setup_flags %d\n", executor_setup_flags());
+    printf("executor_sqpoll %d\n", executor_sqpoll());
+    printf("executor_recv_buffer_ring %d\n", executor_recv_buffer_ring());
+    printf("executor_accept_next %d\n", executor_accept_next());
+    printf("executor_recv_next %d\n", executor_recv_next());
+    printf("executor_send_zc %d\n", executor_send_zc());
+    printf("executor_vectored_io %d\n", executor_vectored_io());
+    printf("executor_connect_close %d\n", executor_connect_close());
+    printf("executor_sleep_until %d\n", executor_sleep_until());
+    printf("executor_deadlines %d\n", executor_deadlines());
+    printf("executor_cancel %d\n", executor_cancel());
+    printf("executor_join_group %d\n", executor_join_group());
 }
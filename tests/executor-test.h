@@ -38,6 +38,208 @@ int executor_valid_init(void);
  */
 int executor_invalid_free(void);
 
+/**
+ * @brief Test case for running tasks to completion in an executor.
+ *
+ * This test spawns tasks that suspend on asynchronous waits and spawn
+ * further tasks, runs the executor and checks that every task completed
+ * and that all frames were returned to the executor.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_run_tasks(void);
+
+/**
+ * @brief Test case for running tasks with different stack sizes.
+ *
+ * This test runs a task that uses a large stack next to tasks using small
+ * ones and checks that each frame got a stack of the requested size.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_stack_sizes(void);
+
+/**
+ * @brief Test case for finishing tasks on stacks larger than the pool keeps.
+ *
+ * This test runs tasks on stacks beyond the size classes of the stack pool,
+ * which are not cached, and checks that they finish on their stack before it
+ * is unmapped.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_oversize_stack(void);
+
+/**
+ * @brief Test case for growing the frames of an executor on demand.
+ *
+ * This test starts more tasks than the executor was initialized for and
+ * checks that the frames array grows without moving existing frames and
+ * that every task runs to completion.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_grow(void);
+
+/**
+ * @brief Test case for the hard frame limit of an executor.
+ *
+ * This test lowers the frame limit of an executor and checks that starting
+ * a task beyond the limit fails while the running tasks complete.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_frame_limit(void);
+
+/**
+ * @brief Test case for tasks waiting for I/O tokens.
+ *
+ * This test runs more concurrent writes than the I/O context has tokens and
+ * checks that the tasks wait for tokens instead of failing, and that the
+ * waits are accounted.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_token_back_pressure(void);
+
+/**
+ * @brief Test case for running tasks on a ring created with setup flags.
+ *
+ * This test creates an executor whose ring uses the single issuer and
+ * deferred task running flags, when supported, and checks that tasks
+ * still complete.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_setup_flags(void);
+
+/**
+ * @brief Test case for running tasks on a ring polled by a kernel thread.
+ *
+ * This test creates an executor whose ring uses SQPOLL with a short idle
+ * time and a CPU affinity, when permitted, and checks that tasks still
+ * complete across the wakeups of the polling thread.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_sqpoll(void);
+
+/**
+ * @brief Test case for receives sharing a ring of a single provided buffer.
+ *
+ * This test runs two tasks receiving into a buffer ring of one buffer. The
+ * second receive finds the ring empty and waits until the first task
+ * recycles the buffer, then both tasks answer their peer.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_recv_buffer_ring(void);
+
+/**
+ * @brief Test case for tasks taking connections from an acceptor.
+ *
+ * This test runs two tasks taking two connections each from an acceptor on
+ * a loopback socket, and checks that all of them came from a single
+ * multishot accept request.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_accept_next(void);
+
+/**
+ * @brief Test case for a task draining a multishot receive stream.
+ *
+ * This test receives a message larger than the buffer ring with a stream,
+ * and checks that the data arrives in order although the request ended
+ * when the ring ran dry and had to be armed again.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_recv_next(void);
+
+/**
+ * @brief Test case for a zero-copy send over a TCP connection.
+ *
+ * This test sends a buffer with async_send_zc and checks that the task
+ * resumes with the whole size, that the buffer is released exactly once
+ * by the notification, and that the peer receives the data.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_send_zc(void);
+
+/**
+ * @brief Test case for vectored and message-based reads and writes.
+ *
+ * This test writes a header and a body with a single vectored write and
+ * reads them back into separate buffers, then exchanges the same data with
+ * sendmsg and recvmsg, and checks that MSG_NOSIGNAL turns a send to a
+ * closed peer into -EPIPE.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_vectored_io(void);
+
+/**
+ * @brief Test case for creating, connecting, shutting down and closing a
+ * socket with requests.
+ *
+ * This test creates a socket and connects it to a loopback listener from a
+ * task, checks that the accepted peer reads the end of the stream after a
+ * shutdown, and that both descriptors are closed by requests.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_connect_close(void);
+
+/**
+ * @brief Test case for sleeping tasks on the timer wheel.
+ *
+ * This test puts tasks to sleep for different durations, checks that they
+ * wake up in the order of their deadlines and never before, and that a task
+ * resumed early by another one cancels its timer and gets -EINTR.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_sleep_until(void);
+
+/**
+ * @brief Test case for reads, writes and accepts with a deadline.
+ *
+ * This test checks that a read from an empty pipe and an accept without a
+ * client fail with -ETIME once their deadline passed, and not before, while
+ * a write and a read that complete in time return their result.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_deadlines(void);
+
+/**
+ * @brief Test case for cancelling tasks and dropping stale completions.
+ *
+ * This test cancels a task suspended on a read through its handle, checks
+ * that it resumes with -ECANCELED and that its handle is no longer valid
+ * once it finished. It then leaves a read in flight behind a finished task,
+ * and checks that its late completion does not resume the next task running
+ * on the same frame.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_cancel(void);
+
+/**
+ * @brief Test case for joining tasks and waiting for task groups.
+ *
+ * This test joins a task from several tasks, checks that a task cannot join
+ * itself and that joining a finished task returns at once. It then fans out
+ * to a group of tasks finishing in a different order than they started, and
+ * checks that the parent resumes with the first one to finish and once all
+ * of them finished.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int executor_join_group(void);
+
 /**
  * @brief Run all executor-related tests.
  *
@@ -1,6 +1,8 @@
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <unistd.h>
 
 #include <IOContext.h>
 
@@ -14,14 +16,14 @@ int valid_request_wait(void)
 {
     struct IOContext ioc;
     MAYBE_UNUSED size_t capacity = 1;
-    MAYBE_UNUSED uint64_t idx = rand();
+    MAYBE_UNUSED struct Waiter waiter = { .is_ready = 0 };
 
     unsigned int msec = 200;
     struct __kernel_timespec ts;
     msec_to_ts(&ts, msec);
 
     assert(init_io_context(&ioc, capacity) == 0);
-    assert(request_wait(&ioc, &ts, NULL, &idx) == 0);
+    assert(request_wait(&ioc, &ts, NULL, &waiter) == 0);
     assert(io_uring_submit(&ioc.ring) == 1);
 
     struct timeval start;
@@ -31,9 +33,9 @@ int valid_request_wait(void)
     assert(io_uring_wait_cqe(&ioc.ring, &cqe) == 0);
     assert(check_elapced_time_msec(&start, msec) == 0);
 
-    MAYBE_UNUSED struct Token *token = (struct Token *)cqe->user_data;
+    MAYBE_UNUSED struct Token *token = token_from_user_data(&ioc, cqe->user_data);
     assert(token->cb == NULL);
-    assert(*(uint64_t *)token->data == idx);
+    assert(token->data == &waiter);
 
     io_uring_cqe_seen(&ioc.ring, cqe);
     return 0;
@@ -47,20 +49,20 @@ static void *do_write(void *data)
 
     struct IOContext ioc;
     MAYBE_UNUSED size_t capacity = 1;
-    MAYBE_UNUSED uint64_t idx = rand();
+    MAYBE_UNUSED struct Waiter waiter = { .is_ready = 0 };
     MAYBE_UNUSED int fd = resolve_connect("127.0.0.1", 40000);
 
     assert(init_io_context(&ioc, capacity) == 0);
-    assert(request_write(&ioc, fd, buffer, PACKET_SIZE, NULL, &idx) == 0);
+    assert(request_write(&ioc, fd, buffer, PACKET_SIZE, NULL, &waiter) == 0);
     assert(io_uring_submit(&ioc.ring) == 1);
 
     struct io_uring_cqe *cqe = NULL;
     assert(io_uring_wait_cqe(&ioc.ring, &cqe) == 0);
 
-    MAYBE_UNUSED struct Token *token = (struct Token *)cqe->user_data;
+    MAYBE_UNUSED struct Token *token = token_from_user_data(&ioc, cqe->user_data);
     assert(cqe->res == PACKET_SIZE);
     assert(token->cb == NULL);
-    assert(*(uint64_t *)token->data == idx);
+    assert(token->data == &waiter);
     assert(token->type == WRITE);
 
     io_uring_cqe_seen(&ioc.ring, cqe);
@@ -72,12 +74,12 @@ int request_read_write(void)
     MAYBE_UNUSED char buffer[PACKET_SIZE] = { 0 };
     struct IOContext ioc;
     MAYBE_UNUSED size_t capacity = 1;
-    MAYBE_UNUSED uint64_t idx = rand();
+    MAYBE_UNUSED struct Waiter waiter = { .is_ready = 0 };
     MAYBE_UNUSED int fd = bind_to("127.0.0.1", 40000);
     assert(fd > 0);
 
     assert(init_io_context(&ioc, capacity) == 0);
-    assert(request_read(&ioc, fd, buffer, PACKET_SIZE, NULL, &idx) == 0);
+    assert(request_read(&ioc, fd, buffer, PACKET_SIZE, NULL, &waiter) == 0);
     assert(io_uring_submit(&ioc.ring) == 1);
 
     pthread_t write_thread;
@@ -86,10 +88,10 @@ int request_read_write(void)
     struct io_uring_cqe *cqe = NULL;
     assert(io_uring_wait_cqe(&ioc.ring, &cqe) == 0);
 
-    MAYBE_UNUSED struct Token *token = (struct Token *)cqe->user_data;
+    MAYBE_UNUSED struct Token *token = token_from_user_data(&ioc, cqe->user_data);
     assert(cqe->res == PACKET_SIZE);
     assert(token->cb == NULL);
-    assert(*(uint64_t *)token->data == idx);
+    assert(token->data == &waiter);
     assert(token->type == READ);
     assert(strcmp(buffer, MESSAGE) == 0);
 
@@ -101,8 +103,389 @@ int request_read_write(void)
     return 0;
 }
 
+int process_resume_waiter(void)
+{
+    struct IOContext ioc;
+    struct Waiter waiter = { .is_ready = 0 };
+
+    struct __kernel_timespec ts;
+    msec_to_ts(&ts, 1);
+
+    if (init_io_context(&ioc, 4) < 0)
+        return -1;
+
+    MAYBE_UNUSED int ret = request_wait(&ioc, &ts, NULL, &waiter);
+    assert(ret == 0);
+    while (ioc.ready_head == NULL)
+        process(&ioc, 4);
+
+    MAYBE_UNUSED struct Waiter *ready = pop_ready_waiter(&ioc);
+    assert(ready == &waiter);
+    assert(waiter.is_ready == 1);
+    assert(waiter.result == -ETIME);
+    assert(pop_ready_waiter(&ioc) == NULL);
+    assert(ioc.tail == ioc.capacity);
+
+    free_io_context(&ioc);
+    return 0;
+}
+
+int request_full_sq(void)
+{
+    struct IOContext ioc;
+    struct Waiter waiter = { .is_ready = 0 };
+    struct Waiter parked = { .is_ready = 0 };
+
+    struct __kernel_timespec ts;
+    msec_to_ts(&ts, 1);
+
+    if (init_io_context(&ioc, 8) < 0)
+        return -1;
+
+    struct io_uring_sqe *sqe = NULL;
+    while ((sqe = io_uring_get_sqe(&ioc.ring)) != NULL) {
+        io_uring_prep_nop(sqe);
+        sqe->user_data = 0;
+    }
+
+    MAYBE_UNUSED int ret = request_wait(&ioc, &ts, NULL, &waiter);
+    assert(ret == 0);
+    assert(ioc.stats.sq_flushes == 1);
+
+    push_sq_waiter(&ioc, &parked);
+    ret = process(&ioc, 64);
+    assert(ret >= 0);
+    assert(parked.is_ready == 1);
+    assert(pop_ready_waiter(&ioc) == &parked);
+
+    while (ioc.ready_head == NULL)
+        process(&ioc, 64);
+
+    assert(pop_ready_waiter(&ioc) == &waiter);
+    assert(waiter.result == -ETIME);
+
+    free_io_context(&ioc);
+    return 0;
+}
+
+int process_wait_policy(void)
+{
+    struct IOContext ioc;
+    struct IOContextOptions options = {
+        .wait_completions = 8,
+        .wait_timeout_us = 200000,
+    };
+    struct Waiter waiters[2] = { { .is_ready = 0 }, { .is_ready = 0 } };
+
+    struct __kernel_timespec ts;
+    msec_to_ts(&ts, 1);
+
+    if (init_io_context_with_options(&ioc, 8, &options) < 0)
+        return -1;
+
+    assert(set_wait_policy(&ioc, 0, 1000) == -1);
+    assert(set_wait_policy(&ioc, 2, 0) == -1);
+    assert(ioc.wait_completions == 8);
+
+    for (int i = 0; i < 2; ++i) {
+        MAYBE_UNUSED int ret = request_wait(&ioc, &ts, NULL, &waiters[i]);
+        assert(ret == 0);
+    }
+
+    // Both timers are submitted and awaited by a single system call, which
+    // does not wait for more completions than requests are in flight.
+    MAYBE_UNUSED int count = process(&ioc, 8);
+    assert(count == 2);
+    assert(ioc.stats.enters == 1);
+    assert(pop_ready_waiter(&ioc) == &waiters[0]);
+    assert(pop_ready_waiter(&ioc) == &waiters[1]);
+
+    count = process(&ioc, 8);
+    assert(count == 0);
+    assert(ioc.stats.wait_timeouts == 1);
+
+    free_io_context(&ioc);
+    return 0;
+}
+
+int process_spin_policy(void)
+{
+    struct IOContext ioc;
+    struct IOContextOptions options = { .spin_ns = 20000000 };
+    struct Waiter waiter = { .is_ready = 0 };
+
+    struct __kernel_timespec ts = { .tv_sec = 0, .tv_nsec = 100000 };
+
+    if (init_io_context_with_options(&ioc, 4, &options) < 0)
+        return -1;
+
+    MAYBE_UNUSED int ret = request_wait(&ioc, &ts, NULL, &waiter);
+    assert(ret == 0);
+
+    // The timer fires well within the budget: no sleep in the kernel.
+    MAYBE_UNUSED int count = process(&ioc, 4);
+    assert(count == 1);
+    assert(ioc.stats.spins == 1);
+    assert(ioc.stats.spin_hits == 1);
+    assert(ioc.stats.sleeps == 0);
+    assert(ioc.spin_budget_ns < options.spin_ns);
+    assert(pop_ready_waiter(&ioc) == &waiter);
+
+    // A slow completion exhausts the budget and turns spinning off.
+    msec_to_ts(&ts, 200);
+    ret = request_wait(&ioc, &ts, NULL, &waiter);
+    assert(ret == 0);
+    count = process(&ioc, 4);
+    assert(count == 1);
+    assert(ioc.stats.sleeps == 1);
+    assert(ioc.spin_budget_ns == 0);
+
+    assert(set_spin_policy(&ioc, 0) == 0);
+    free_io_context(&ioc);
+    return 0;
+}
+
+int request_direct_read_write(void)
+{
+    struct IOContext ioc;
+    struct Waiter waiter = { .is_ready = 0 };
+    char buffer[PACKET_SIZE] = MESSAGE;
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return -1;
+
+    if (init_io_context(&ioc, 8) < 0 || register_files(&ioc, 4, 0) < 0)
+        return -1;
+
+    // The table keeps the socket open once it is installed.
+    int slot = register_file(&ioc, fds[0]);
+    assert(slot >= 0);
+    close(fds[0]);
+
+    MAYBE_UNUSED int ret = request_write_direct(
+        &ioc, (uint32_t)slot, buffer, sizeof(MESSAGE), NULL, &waiter);
+    assert(ret == 0);
+    while (ioc.ready_head == NULL)
+        process(&ioc, 8);
+    assert(pop_ready_waiter(&ioc) == &waiter);
+    assert(waiter.result == sizeof(MESSAGE));
+
+    memset(buffer, 0, sizeof(buffer));
+    MAYBE_UNUSED ssize_t length = read(fds[1], buffer, sizeof(buffer));
+    assert(length == sizeof(MESSAGE));
+    assert(strcmp(buffer, MESSAGE) == 0);
+
+    length = write(fds[1], MESSAGE, sizeof(MESSAGE));
+    waiter.is_ready = 0;
+    ret = request_read_direct(&ioc, (uint32_t)slot, buffer, sizeof(buffer),
+                              NULL, &waiter);
+    assert(ret == 0);
+    while (ioc.ready_head == NULL)
+        process(&ioc, 8);
+    assert(pop_ready_waiter(&ioc) == &waiter);
+    assert(waiter.result == sizeof(MESSAGE));
+
+    assert(unregister_file(&ioc, (uint32_t)slot) == 0);
+    assert(ioc.file_tail == 4);
+
+    close(fds[1]);
+    free_io_context(&ioc);
+    return 0;
+}
+
+int request_fixed_read_write(void)
+{
+    struct IOContext ioc;
+    struct Waiter waiter = { .is_ready = 0 };
+    char buffer[PACKET_SIZE] = MESSAGE;
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return -1;
+
+    if (init_io_context(&ioc, 8) < 0 ||
+        register_buffers(&ioc, PACKET_SIZE, 2) < 0)
+        return -1;
+
+    // Only the memory of the arena can be used by fixed requests.
+    MAYBE_UNUSED int ret = request_write_fixed(&ioc, fds[0], buffer,
+                                               sizeof(MESSAGE), NULL, &waiter);
+    assert(ret == -EINVAL);
+
+    char *out = (char *)acquire_buffer(&ioc);
+    char *in = (char *)acquire_buffer(&ioc);
+    memcpy(out, MESSAGE, sizeof(MESSAGE));
+
+    ret = request_write_fixed(&ioc, fds[0], out, sizeof(MESSAGE), NULL,
+                              &waiter);
+    assert(ret == 0);
+    while (ioc.ready_head == NULL)
+        process(&ioc, 8);
+    assert(pop_ready_waiter(&ioc) == &waiter);
+    assert(waiter.result == sizeof(MESSAGE));
+
+    memset(buffer, 0, sizeof(buffer));
+    MAYBE_UNUSED ssize_t length = read(fds[1], buffer, sizeof(buffer));
+    assert(length == sizeof(MESSAGE));
+    assert(strcmp(buffer, MESSAGE) == 0);
+
+    length = write(fds[1], MESSAGE, sizeof(MESSAGE));
+    waiter.is_ready = 0;
+    ret = request_read_fixed(&ioc, fds[0], in, PACKET_SIZE, NULL, &waiter);
+    assert(ret == 0);
+    while (ioc.ready_head == NULL)
+        process(&ioc, 8);
+    assert(pop_ready_waiter(&ioc) == &waiter);
+    assert(waiter.result == sizeof(MESSAGE));
+    assert(strcmp(in, MESSAGE) == 0);
+
+    release_buffer(&ioc, in);
+    release_buffer(&ioc, out);
+    assert(ioc.buffers.tail == 2);
+
+    close(fds[0]);
+    close(fds[1]);
+    free_io_context(&ioc);
+    return 0;
+}
+
+static ssize_t recv_select(struct IOContext *ioc, int fd,
+                           struct Waiter *waiter)
+{
+    waiter->is_ready = 0;
+    MAYBE_UNUSED int ret = request_recv_select(ioc, fd, NULL, waiter);
+    assert(ret == 0);
+    while (ioc->ready_head == NULL)
+        process(ioc, 8);
+    assert(pop_ready_waiter(ioc) == waiter);
+    return waiter->result;
+}
+
+int request_recv_buffer_ring(void)
+{
+    struct IOContext ioc;
+    struct Waiter waiter = { .is_ready = 0 };
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return -1;
+
+    if (init_io_context(&ioc, 8) < 0)
+        return -1;
+
+    MAYBE_UNUSED int ret = request_recv_select(&ioc, fds[0], NULL, &waiter);
+    assert(ret == -EINVAL);
+    assert(register_buffer_ring(&ioc, PACKET_SIZE, 3) == -EINVAL);
+    if (register_buffer_ring(&ioc, PACKET_SIZE, 2) < 0) {
+        free_io_context(&ioc);
+        return -1;
+    }
+
+    // Every receive takes its own buffer until the ring runs dry.
+    int ids[2];
+    for (int i = 0; i < 2; ++i) {
+        MAYBE_UNUSED ssize_t length = write(fds[1], MESSAGE, sizeof(MESSAGE));
+        length = recv_select(&ioc, fds[0], &waiter);
+        assert(length == sizeof(MESSAGE));
+        ids[i] = completion_buffer(waiter.flags);
+        assert(ids[i] >= 0 && ids[i] < 2);
+        assert(strcmp(provided_buffer(&ioc, (uint16_t)ids[i]), MESSAGE) == 0);
+    }
+    assert(ids[0] != ids[1]);
+
+    MAYBE_UNUSED ssize_t length = write(fds[1], MESSAGE, sizeof(MESSAGE));
+    length = recv_select(&ioc, fds[0], &waiter);
+    assert(length == -ENOBUFS);
+    assert(ioc.provided.available == 0);
+
+    recycle_buffer(&ioc, (uint16_t)ids[1]);
+    assert(ioc.provided.available == 1);
+    length = recv_select(&ioc, fds[0], &waiter);
+    assert(length == sizeof(MESSAGE));
+    assert(completion_buffer(waiter.flags) == ids[1]);
+
+    close(fds[0]);
+    close(fds[1]);
+    free_io_context(&ioc);
+    assert(ioc.provided.ring == NULL);
+    return 0;
+}
+
+struct Accepted {
+    int count;
+    int armed;
+    int slots[4];
+};
+
+static void on_accept(int slot, uint32_t flags, void *data)
+{
+    struct Accepted *accepted = (struct Accepted *)data;
+    assert(slot >= 0);
+    accepted->armed += (flags & IORING_CQE_F_MORE) != 0;
+    accepted->slots[accepted->count++] = slot;
+}
+
+int request_multishot_accept_direct_slots(void)
+{
+    struct IOContext ioc;
+    struct Accepted accepted = { .count = 0 };
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int clients[3];
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        listen(server, 8) < 0 ||
+        getsockname(server, (struct sockaddr *)&address, &length) < 0)
+        return -1;
+
+    if (init_io_context(&ioc, 8) < 0 || register_files(&ioc, 8, 4) < 0)
+        return -1;
+
+    MAYBE_UNUSED int ret =
+        request_multishot_accept_direct(&ioc, server, &on_accept, &accepted);
+    assert(ret == 0);
+
+    for (int i = 0; i < 3; ++i) {
+        clients[i] = socket(AF_INET, SOCK_STREAM, 0);
+        ret = connect(clients[i], (struct sockaddr *)&address, sizeof(address));
+        assert(ret == 0);
+    }
+
+    while (accepted.count < 3)
+        process(&ioc, 8);
+
+    // Connections land in the kernel range and the request stays armed.
+    assert(accepted.armed == 3);
+    for (int i = 0; i < 3; ++i) {
+        assert(accepted.slots[i] >= 4 && accepted.slots[i] < 8);
+        assert(unregister_file(&ioc, (uint32_t)accepted.slots[i]) == 0);
+    }
+    assert(ioc.tail == ioc.capacity - 1);
+    assert(ioc.file_tail == 4);
+
+    for (int i = 0; i < 3; ++i)
+        close(clients[i]);
+    close(server);
+    free_io_context(&ioc);
+    return 0;
+}
+
 void run_io_context_integeration_tests(void)
 {
     printf("valid_request_wait %d\n", valid_request_wait());
     printf("request_read_write %d\n", request_read_write());
+    printf("process_resume_waiter %d\n", process_resume_waiter());
+    printf("request_full_sq %d\n", request_full_sq());
+    printf("process_wait_policy %d\n", process_wait_policy());
+    printf("process_spin_policy %d\n", process_spin_policy());
+    printf("request_direct_read_write %d\n", request_direct_read_write());
+    printf("request_fixed_read_write %d\n", request_fixed_read_write());
+    printf("request_recv_buffer_ring %d\n", request_recv_buffer_ring());
+    printf("request_multishot_accept_direct_slots %d\n",
+           request_multishot_accept_direct_slots());
 }
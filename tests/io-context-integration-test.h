@@ -36,6 +36,93 @@ void run_io_context_integeration_tests(void);
  */
 int request_read_write(void);
 
+/**
+ * @brief Test case for resuming a waiter from the completion queue.
+ *
+ * This test issues a wait request without a callback and checks that
+ * processing its completion stores the result in the waiter and appends
+ * it to the ready queue of the IO context.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int process_resume_waiter(void);
+
+/**
+ * @brief Test case for requests issued while the submission queue is full.
+ *
+ * This test fills the submission queue, checks that a request flushes it
+ * on demand instead of failing, and that waiters parked on the queue are
+ * made ready by the next call to process.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int request_full_sq(void);
+
+/**
+ * @brief Test case for the wait policy of process.
+ *
+ * This test waits for more completions than requests are in flight, checks
+ * that they are submitted and awaited in a single system call, and that a
+ * wait without requests ends with the timeout of the policy.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int process_wait_policy(void);
+
+/**
+ * @brief Test case for the spin policy of process.
+ *
+ * This test checks that a quick completion is caught by spinning without
+ * sleeping in the kernel, and that a completion slower than the longest
+ * spin makes process stop spinning.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int process_spin_policy(void);
+
+/**
+ * @brief Test case for reads and writes on a registered file.
+ *
+ * This test installs one end of a socket pair in the registered file table,
+ * closes its descriptor, and exchanges a message through the slot.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int request_direct_read_write(void);
+
+/**
+ * @brief Test case for fixed reads and writes on the registered buffers.
+ *
+ * This test exchanges a message over a socket pair from and into slices of
+ * the registered buffer arena, and checks that a buffer out of the arena is
+ * rejected.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int request_fixed_read_write(void);
+
+/**
+ * @brief Test case for receives into the buffers of a provided buffer ring.
+ *
+ * This test receives messages until the buffer ring runs dry, checks that
+ * each receive picked its own buffer and that an empty ring fails the
+ * receive, then recycles a buffer and receives into it again.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int request_recv_buffer_ring(void);
+
+/**
+ * @brief Test case for a multishot accept installing direct descriptors.
+ *
+ * This test arms a single multishot accept request, connects several clients,
+ * and checks that every connection is installed in the slots reserved to the
+ * kernel while the request keeps its token.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int request_multishot_accept_direct_slots(void);
+
 #ifdef __cplusplus
 }
 #endif
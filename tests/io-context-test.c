@@ -49,7 +49,8 @@ int ioc_valid_free(void)
     assert(free_io_context(&ioc) == 0);
     assert(ioc.tail == 0);
     assert(ioc.capacity == 0);
-    assert(ioc.available_tokens == NULL);
+    assert(ioc.tokens == NULL);
+    assert(ioc.free_tokens == NULL);
     return 0;
 }
 
@@ -63,9 +64,10 @@ int ioc_evaluate_tokens(void)
     assert(ioc.capacity == expected_capacity);
 
     MAYBE_UNUSED struct Token *token = NULL;
+    MAYBE_UNUSED struct Token *tokens[64];
     for (size_t i = 0; i < expected_capacity; ++i) {
-        token = get_token(&ioc);
-        assert(token != NULL);
+        tokens[i] = get_token(&ioc);
+        assert(tokens[i] != NULL);
     }
 
     assert(ioc.tail == 0);
@@ -78,13 +80,13 @@ int ioc_evaluate_tokens(void)
     assert(ioc.tail == 0);
 
     for (size_t i = 0; i < expected_capacity; ++i) {
-        assert((release_token(&ioc, ioc.available_tokens[i]), 1));
+        assert((release_token(&ioc, tokens[i]), 1));
     }
 
     assert(ioc.tail == expected_capacity);
 
     for (size_t i = 0; i < expected_capacity; ++i) {
-        assert((release_token(&ioc, ioc.available_tokens[i]), 1));
+        assert((release_token(&ioc, tokens[i]), 1));
     }
 
     assert(ioc.tail == expected_capacity);
@@ -93,6 +95,122 @@ int ioc_evaluate_tokens(void)
     return 0;
 }
 
+int ioc_token_user_data(void)
+{
+    struct IOContext ioc;
+    if (init_io_context(&ioc, 8) < 0)
+        return -1;
+
+    MAYBE_UNUSED uintptr_t address = (uintptr_t)ioc.tokens;
+    assert(address % CACHE_LINE_SIZE == 0);
+    assert(sizeof(struct Token) == 32);
+
+    struct Token *token = get_token(&ioc);
+    MAYBE_UNUSED uint64_t user_data = token_user_data(&ioc, token);
+    assert(user_data != 0);
+    assert(token_from_user_data(&ioc, user_data) == token);
+    assert(token_from_user_data(&ioc, 0) == NULL);
+
+    uint32_t index = (uint32_t)(token - ioc.tokens);
+    release_tokens(&ioc, &index, 1);
+    assert(ioc.tail == ioc.capacity);
+    assert(token_from_user_data(&ioc, user_data) == NULL);
+
+    MAYBE_UNUSED struct Token *reused = get_token(&ioc);
+    assert(reused == token);
+    assert(token_user_data(&ioc, reused) != user_data);
+
+    free_io_context(&ioc);
+    return 0;
+}
+
+int ioc_setup_options(void)
+{
+    struct IOContext ioc;
+    struct IOContextOptions options = {
+        .flags = IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_COOP_TASKRUN |
+                 IORING_SETUP_CLAMP,
+        .cq_entries = 64,
+    };
+
+    if (init_io_context_with_options(&ioc, 8, &options) < 0)
+        return -1;
+
+    MAYBE_UNUSED uint32_t flags = ioc.setup_flags;
+    assert(flags & IORING_SETUP_CQSIZE);
+    assert(flags & IORING_SETUP_CLAMP);
+    assert(!(flags & IORING_SETUP_DEFER_TASKRUN) ||
+           (flags & IORING_SETUP_SINGLE_ISSUER));
+    assert(*ioc.ring.cq.kring_entries == 64);
+
+    free_io_context(&ioc);
+    return 0;
+}
+
+int ioc_file_slots(void)
+{
+    struct IOContext ioc;
+    if (init_io_context(&ioc, 8) < 0)
+        return -1;
+
+    assert(allocate_file_slot(&ioc) == -ENFILE);
+    assert(register_files(&ioc, 8, 9) == -EINVAL);
+    if (register_files(&ioc, 8, 2) < 0) {
+        free_io_context(&ioc);
+        return -1;
+    }
+    assert(register_files(&ioc, 8, 2) == -EINVAL);
+
+    // Only the slots left out of the kernel range are handed out.
+    MAYBE_UNUSED int slots[6];
+    for (int i = 0; i < 6; ++i) {
+        slots[i] = allocate_file_slot(&ioc);
+        assert(slots[i] >= 0 && slots[i] < 6);
+    }
+    assert(allocate_file_slot(&ioc) == -ENFILE);
+
+    release_file_slot(&ioc, (uint32_t)slots[3]);
+    assert(allocate_file_slot(&ioc) == slots[3]);
+
+    free_io_context(&ioc);
+    assert(ioc.free_files == NULL);
+    return 0;
+}
+
+int ioc_buffer_arena(void)
+{
+    struct IOContext ioc;
+    if (init_io_context(&ioc, 8) < 0)
+        return -1;
+
+    assert(acquire_buffer(&ioc) == NULL);
+    assert(register_buffers(&ioc, 100, MAX_BUFFER_SLICES + 1) == -EINVAL);
+    if (register_buffers(&ioc, 100, 4) < 0) {
+        free_io_context(&ioc);
+        return -1;
+    }
+    assert(register_buffers(&ioc, 100, 4) == -EINVAL);
+    assert(ioc.buffers.slice_size % CACHE_LINE_SIZE == 0);
+
+    MAYBE_UNUSED uint8_t *slices[4];
+    for (int i = 0; i < 4; ++i) {
+        slices[i] = (uint8_t *)acquire_buffer(&ioc);
+        assert(slices[i] != NULL);
+    }
+    assert(acquire_buffer(&ioc) == NULL);
+
+    // Any address inside a slice maps to the slice holding it.
+    assert(buffer_index(&ioc, slices[2] + 99) == buffer_index(&ioc, slices[2]));
+    assert(buffer_index(&ioc, &ioc) == -1);
+
+    release_buffer(&ioc, slices[1]);
+    assert(acquire_buffer(&ioc) == slices[1]);
+
+    free_io_context(&ioc);
+    assert(ioc.buffers.memory == NULL);
+    return 0;
+}
+
 void run_io_context_tests(void)
 {
     printf("ioc_invalid_init %d\n", ioc_invalid_init());
@@ -100,4 +218,8 @@ void run_io_context_tests(void)
     printf("ioc_invalid_free %d\n", ioc_invalid_free());
     printf("ioc_valid_free %d\n", ioc_valid_free());
     printf("ioc_evaluate_tokens %d\n", ioc_evaluate_tokens());
+    printf("ioc_token_user_data %d\n", ioc_token_user_data());
+    printf("ioc_setup_options %d\n", ioc_setup_options());
+    printf("ioc_file_slots %d\n", ioc_file_slots());
+    printf("ioc_buffer_arena %d\n", ioc_buffer_arena());
 }
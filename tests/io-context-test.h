@@ -58,6 +58,49 @@ int ioc_valid_free(void);
  */
 int ioc_evaluate_tokens(void);
 
+/**
+ * @brief Test case for encoding tokens as sqe user_data.
+ *
+ * This test checks that tokens are laid out in an aligned slab, that a
+ * token round-trips through its user_data, and that the user_data of a
+ * released token no longer resolves once the token is reused.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int ioc_token_user_data(void);
+
+/**
+ * @brief Test case for creating the ring of an IO context with options.
+ *
+ * This test requests the single issuer, deferred task running, clamp and
+ * completion queue size setup options and checks the flags the ring was
+ * created with.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int ioc_setup_options(void);
+
+/**
+ * @brief Test case for the slots of the registered file table.
+ *
+ * This test registers a file table with slots reserved to the kernel and
+ * checks that only the other slots are allocated, until they run out.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int ioc_file_slots(void);
+
+/**
+ * @brief Test case for the slices of the registered buffer arena.
+ *
+ * This test registers a small arena and checks that its slices are handed
+ * out until they run out, mapped back to their index, and reused once
+ * released.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int ioc_buffer_arena(void);
+
 /**
  * @brief Run tests for the IO context module.
  *
@@ -4,6 +4,8 @@
 #include "io-context-test.h"
 #include "io-context-integration-test.h"
 #include "executor-test.h"
+#include "stack-test.h"
+#include "timer-wheel-test.h"
 #include "utils.h"
 
 #define THREADS_NO 4
@@ -12,6 +14,8 @@ void *run_tests(void *data MAYBE_UNUSED)
 {
     run_io_context_tests();
     run_executor_tests();
+    run_stack_tests();
+    run_timer_wheel_tests();
     pthread_exit(NULL);
 }
 
@@ -0,0 +1,98 @@
+#include <assert.h>
+#include <string.h>
+
+#include <Stack.h>
+
+#include "stack-test.h"
+#include "utils.h"
+
+#define STACKS_NO 8
+
+int stack_pool_reuse(void)
+{
+    struct StackPool pool;
+    struct Stack first;
+    struct Stack second;
+    struct Stack third;
+
+    if (init_stack_pool(&pool, STACK_POOL_HIGH_WATER) < 0)
+        return -1;
+
+    if (acquire_stack(&pool, &first, 8192) < 0)
+        return -1;
+
+    MAYBE_UNUSED void *memory = first.memory;
+    release_stack(&pool, &first);
+    assert(first.memory == NULL);
+    assert(pool.stats.cached_bytes == 8192);
+
+    if (acquire_stack(&pool, &second, 5000) < 0 ||
+        acquire_stack(&pool, &third, 8192) < 0)
+        return -1;
+
+    assert(second.memory == memory);
+    assert(second.size == 8192);
+    assert(third.memory != memory);
+    assert(pool.stats.hits == 1);
+    assert(pool.stats.misses == 2);
+    assert(pool.stats.mapped_bytes == 2 * 8192);
+
+    release_stack(&pool, &third);
+    release_stack(&pool, &second);
+    assert(pool.stats.cached_bytes == 2 * 8192);
+
+    free_stack_pool(&pool);
+    return 0;
+}
+
+int stack_pool_trim(void)
+{
+    struct StackPool pool;
+    struct Stack stacks[STACKS_NO];
+    size_t page = stack_page_size();
+
+    if (init_stack_pool(&pool, 2 * page) < 0)
+        return -1;
+
+    for (int i = 0; i < STACKS_NO; ++i) {
+        if (acquire_stack(&pool, &stacks[i], page) < 0)
+            return -1;
+        memset(stack_bottom(&stacks[i]), i + 1, page);
+    }
+
+    MAYBE_UNUSED void *hottest = stacks[STACKS_NO - 1].memory;
+    for (int i = 0; i < STACKS_NO; ++i)
+        release_stack(&pool, &stacks[i]);
+
+    assert(pool.stats.trims > 0);
+    assert(pool.cached_resident <= 2 * page);
+    assert(pool.stats.resident_bytes == pool.cached_resident);
+
+    struct Stack stack;
+    if (acquire_stack(&pool, &stack, page) < 0)
+        return -1;
+
+    assert(stack.memory == hottest);
+    assert(*(unsigned char *)stack_bottom(&stack) == STACKS_NO);
+    release_stack(&pool, &stack);
+
+    for (int i = 0; i < STACKS_NO; ++i) {
+        if (acquire_stack(&pool, &stacks[i], page) < 0)
+            return -1;
+    }
+
+    assert(*(unsigned char *)stack_bottom(&stacks[STACKS_NO - 1]) == 0);
+    assert(pool.stats.hits == STACKS_NO + 1);
+
+    for (int i = 0; i < STACKS_NO; ++i)
+        release_stack(&pool, &stacks[i]);
+
+    free_stack_pool(&pool);
+    return 0;
+}
+
+void run_stack_tests(void)
+{
+    printf("stack_pool_reuse %d\n", stack_pool_reuse());
+    printf("stack_pool_trim %d\n", stack_pool_trim());
+}
@@ -0,0 +1,43 @@
+#ifndef STACK_TEST_H
+#define STACK_TEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Test case for reusing stacks from the stack pool.
+ *
+ * This test verifies that a released stack is handed out again for the next
+ * request of the same size class, and that hits and misses of the pool are
+ * counted accordingly.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int stack_pool_reuse(void);
+
+/**
+ * @brief Test case for giving cached stacks back to the kernel.
+ *
+ * This test releases more stacks than the high-water mark of the pool allows
+ * and checks that the coldest stacks are given back while the most recently
+ * released one keeps its content.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int stack_pool_trim(void);
+
+/**
+ * @brief Run all stack-related tests.
+ *
+ * This function serves as a container for executing all the test cases
+ * related to the stack module. It calls each individual test case
+ * and reports the overall result.
+ */
+void run_stack_tests(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
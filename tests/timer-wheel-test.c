@@ -0,0 +1,108 @@
+#include <stdio.h>
+
+#include <TimerWheel.h>
+
+#include "timer-wheel-test.h"
+
+#define TIMERS_NO 9
+
+struct Victim {
+    int fired;
+    struct TimerWheel *wheel;
+    struct Timer *timer;
+};
+
+static void count_fire(void *data)
+{
+    ++*(int *)data;
+}
+
+int timer_wheel_expiry(void)
+{
+    struct TimerWheel wheel;
+    struct Timer timers[TIMERS_NO];
+    int fired[TIMERS_NO] = { 0 };
+    uint64_t span = 1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+
+    // Deadlines in ticks from the start, sorted, across every level.
+    uint64_t start = 123457 * TIMER_TICK_NS + 1;
+    uint64_t offsets[TIMERS_NO] = { 0,    63,     64,      65,      4095,
+                                    4097, 300000, 9999999, span + 10 };
+
+    init_timer_wheel(&wheel, start);
+    for (int i = 0; i < TIMERS_NO; ++i) {
+        init_timer(&timers[i], &count_fire, &fired[i]);
+        arm_timer(&wheel, &timers[i], start + offsets[i] * TIMER_TICK_NS);
+    }
+
+    for (int i = 0; i < TIMERS_NO; ++i) {
+        uint64_t deadline = (start / TIMER_TICK_NS + offsets[i] + 1) *
+                            TIMER_TICK_NS;
+        advance_timer_wheel(&wheel, deadline - 1);
+        if (fired[i] != 0 || timer_armed(&timers[i]) == 0)
+            return -1;
+
+        advance_timer_wheel(&wheel, deadline);
+        if (fired[i] != 1 || timer_armed(&timers[i]))
+            return -1;
+    }
+
+    return wheel.count == 0 ? 0 : -1;
+}
+
+static void cancel_victim(void *data)
+{
+    struct Victim *victim = (struct Victim *)data;
+    ++victim->fired;
+    cancel_timer(victim->wheel, victim->timer);
+}
+
+int timer_wheel_cancel(void)
+{
+    struct TimerWheel wheel;
+    struct Timer first, second, third, victim;
+    int fired[3] = { 0 };
+    uint64_t start = 1000 * TIMER_TICK_NS;
+
+    init_timer_wheel(&wheel, start);
+    struct Victim canceller = { .wheel = &wheel, .timer = &victim };
+    init_timer(&first, &cancel_victim, &canceller);
+    init_timer(&second, &count_fire, &fired[0]);
+    init_timer(&third, &count_fire, &fired[1]);
+    init_timer(&victim, &count_fire, &fired[2]);
+
+    // Slots fire last in first, so the victim is due right after the first.
+    arm_timer(&wheel, &victim, start + 10 * TIMER_TICK_NS);
+    arm_timer(&wheel, &first, start + 10 * TIMER_TICK_NS);
+    arm_timer(&wheel, &second, start + 10 * TIMER_TICK_NS);
+    arm_timer(&wheel, &third, start + 200 * TIMER_TICK_NS);
+    if (wheel.count != 4)
+        return -1;
+
+    if (cancel_timer(&wheel, &third) != 1 || cancel_timer(&wheel, &third) != 0)
+        return -1;
+
+    arm_timer(&wheel, &second, start + 5 * TIMER_TICK_NS);
+    if (wheel.count != 3 ||
+        next_timer_deadline(&wheel) != start + 5 * TIMER_TICK_NS)
+        return -1;
+
+    advance_timer_wheel(&wheel, start + 5 * TIMER_TICK_NS);
+    if (fired[0] != 1 || canceller.fired != 0)
+        return -1;
+
+    advance_timer_wheel(&wheel, start + 100 * TIMER_TICK_NS);
+    if (canceller.fired != 1 || fired[1] != 0 || fired[2] != 0)
+        return -1;
+
+    return wheel.count == 0 &&
+                   next_timer_deadline(&wheel) == NO_TIMER_DEADLINE
+               ? 0
+               : -1;
+}
+
+void run_timer_wheel_tests(void)
+{
+    printf("timer_wheel_expiry %d\n", timer_wheel_expiry());
+    printf("timer_wheel_cancel %d\n", timer_wheel_cancel());
+}
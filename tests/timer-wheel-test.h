@@ -0,0 +1,43 @@
+#ifndef TIMER_WHEEL_TEST_H
+#define TIMER_WHEEL_TEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Test case for firing timers at their deadline on every level.
+ *
+ * This test arms timers from less than a tick to beyond the span of the
+ * wheel, and checks that each of them fires with the first advance reaching
+ * its deadline rounded up to a tick, and not one nanosecond before.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int timer_wheel_expiry(void);
+
+/**
+ * @brief Test case for cancelling and moving timers.
+ *
+ * This test cancels and moves armed timers, checks the next deadline of the
+ * wheel, and cancels a timer due in the same tick from the callback of
+ * another one.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+int timer_wheel_cancel(void);
+
+/**
+ * @brief Run all timer wheel related tests.
+ *
+ * This function serves as a container for executing all the test cases
+ * related to the timer wheel module. It calls each individual test case
+ * and reports the overall result.
+ */
+void run_timer_wheel_tests(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif